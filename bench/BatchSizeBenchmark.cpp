@@ -0,0 +1,79 @@
+/**
+ * epoll_wait() calls per event with many ready sockets, for a fixed batch of 10 events (the former hardcoded size),
+ * a fixed batch of 64 events and the adaptive batch which grows up to 4096 events.
+ * Every round makes all sockets readable at once, the loop then runs until it handled all of them.
+ */
+#include "Epoll.h"
+#include <chrono>
+#include <cstdio>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+constexpr int SOCKETS_NUM = 4000;
+constexpr int ROUNDS_NUM = 100;
+
+long handledEvents = 0;
+
+void onReadable(int fd, void *) {
+    char byte;
+    if (read(fd, &byte, 1) == 1) {
+        handledEvents++;
+    }
+}
+
+void runBenchmark(const char *name, int initialBatchSize, int maxBatchSize) {
+    Epoll epoll{false, initialBatchSize, maxBatchSize};
+    std::vector<int> clientFds;
+    std::vector<int> serverFds;
+
+    for (int i = 0; i < SOCKETS_NUM; i++) {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds) == -1) {
+            std::perror("socketpair");
+            return;
+        }
+        clientFds.push_back(fds[0]);
+        serverFds.push_back(fds[1]);
+        epoll.addDescriptor(fds[1]);
+        epoll.addEventHandler(fds[1], EPOLLIN, &onReadable, nullptr);
+    }
+
+    long waitsNum = 0;
+    handledEvents = 0;
+    const auto start = std::chrono::steady_clock::now();
+
+    for (int round = 0; round < ROUNDS_NUM; round++) {
+        for (int fd: clientFds) {
+            (void) !write(fd, "x", 1);
+        }
+
+        const long expectedEvents = long(round + 1) * SOCKETS_NUM;
+        while (handledEvents < expectedEvents) {
+            epoll.waitForEvents();
+            waitsNum++;
+        }
+    }
+
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    std::printf("%-22s epoll_wait calls/event %.4f  %.0f ns/event (incl. the write)  final batch %d\n", name,
+                double(waitsNum) / double(handledEvents), elapsed.count() / double(handledEvents), epoll.getBatchSize());
+
+    for (int i = 0; i < SOCKETS_NUM; i++) {
+        epoll.removeDescriptor(serverFds[i]);
+        close(clientFds[i]);
+        close(serverFds[i]);
+    }
+}
+
+}
+
+int main() {
+    std::printf("%d ready sockets per round, %d rounds\n", SOCKETS_NUM, ROUNDS_NUM);
+    runBenchmark("fixed batch 10", 10, 10);
+    runBenchmark("fixed batch 64", 64, 64);
+    runBenchmark("adaptive 64..4096", 64, 4096);
+    return 0;
+}
@@ -0,0 +1,137 @@
+/**
+ * Global allocations per connection under connection churn, counted by replacing the global operator new.
+ * Every round opens 64 socket pairs, registers one end of each (as a bare descriptor with a handler, or as a Connection
+ * which echoes a message), then the peers close and the loop removes them again. A warm-up fills the slab pools first,
+ * so the counted rounds show what a server sees once it reached its peak number of connections.
+ */
+#include "Connection.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+long allocationsNum = 0;
+
+void *countedAllocate(size_t size) {
+    allocationsNum++;
+    if (void *pointer = std::malloc(size == 0 ? 1 : size))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+}
+
+void *operator new(size_t size) { return countedAllocate(size); }
+
+void *operator new[](size_t size) { return countedAllocate(size); }
+
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+
+void operator delete[](void *pointer) noexcept { std::free(pointer); }
+
+void operator delete(void *pointer, size_t) noexcept { std::free(pointer); }
+
+void operator delete[](void *pointer, size_t) noexcept { std::free(pointer); }
+
+namespace {
+
+constexpr int CONNECTIONS_PER_ROUND = 64;
+constexpr int WARM_UP_ROUNDS_NUM = 50;
+constexpr int ROUNDS_NUM = 2000;
+
+void onReadable(int fd, void *) {
+    char buffer[64];
+    (void) !read(fd, buffer, sizeof(buffer));
+}
+
+void onData(Connection &connection) {
+    char buffer[256];
+    size_t size;
+    while ((size = connection.getInput().read(buffer, sizeof(buffer))) > 0) {
+        connection.write(buffer, size);
+    }
+}
+
+/**
+ * Bare descriptors, added with a handler and removed once the peer closed
+ */
+void churnDescriptors(Epoll &epoll, int roundsNum) {
+    for (int round = 0; round < roundsNum; round++) {
+        int pairs[CONNECTIONS_PER_ROUND][2];
+        for (auto &pair: pairs) {
+            if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, pair) == -1) {
+                std::perror("socketpair");
+                std::exit(1);
+            }
+            epoll.addDescriptor(pair[0]);
+            epoll.addEventHandler(pair[0], EPOLLIN, &onReadable, nullptr);
+            (void) !write(pair[1], "ping", 4);
+        }
+        epoll.waitForEvents(0);
+
+        for (auto &pair: pairs) {
+            close(pair[1]);
+            epoll.removeDescriptor(pair[0]);
+            close(pair[0]);
+        }
+    }
+}
+
+/**
+ * Connections echoing one message, closed by the loop once the peer closed
+ */
+void churnConnections(Epoll &epoll, int roundsNum) {
+    for (int round = 0; round < roundsNum; round++) {
+        int peers[CONNECTIONS_PER_ROUND];
+        for (int &peer: peers) {
+            int pair[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, pair) == -1) {
+                std::perror("socketpair");
+                std::exit(1);
+            }
+            epoll.addConnection(pair[0], &onData);
+            peer = pair[1];
+            (void) !write(peer, "ping", 4);
+        }
+        epoll.waitForEvents(0);
+
+        for (int peer: peers) {
+            char buffer[8];
+            (void) !read(peer, buffer, sizeof(buffer));
+            close(peer);
+        }
+        while (!epoll.getMonitoredFds().empty()) {
+            epoll.waitForEvents(0);
+        }
+    }
+}
+
+void runBenchmark(const char *name, bool isEdgeTriggered, void (*churn)(Epoll &, int)) {
+    Epoll epoll{isEdgeTriggered};
+    churn(epoll, WARM_UP_ROUNDS_NUM);
+
+    allocationsNum = 0;
+    const auto start = std::chrono::steady_clock::now();
+    churn(epoll, ROUNDS_NUM);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    const double connectionsNum = double(CONNECTIONS_PER_ROUND) * ROUNDS_NUM;
+    std::printf("%-12s %s  allocations/connection %.3f  %.0f connections/s\n", name, isEdgeTriggered ? "ET" : "LT",
+                double(allocationsNum) / connectionsNum, connectionsNum / elapsed.count());
+}
+
+}
+
+int main() {
+    std::printf("%d connections per round, %d rounds after %d warm-up rounds\n", CONNECTIONS_PER_ROUND, ROUNDS_NUM,
+                WARM_UP_ROUNDS_NUM);
+    for (const bool isEdgeTriggered: {false, true}) {
+        runBenchmark("descriptors", isEdgeTriggered, &churnDescriptors);
+        runBenchmark("connections", isEdgeTriggered, &churnConnections);
+    }
+    return 0;
+}
@@ -0,0 +1,114 @@
+/**
+ * Cost of dispatching one event to its handler. Level triggered sockets stay readable and writable, so every
+ * waitForEvents() pass reports all of them again. Each socket has handlers for five event types, two of which fire.
+ * The same epoll_wait() loop on a raw epoll fd gives the kernel part, the difference is the cost of the dispatch.
+ * LevelTriggeredEpoll runs the same loop with the trigger mode fixed at compile time.
+ * The best of several runs is printed, the single runs are noisy.
+ */
+#include "Epoll.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+constexpr int SOCKETS_NUM = 1000;
+constexpr int PASSES_NUM = 2000;
+constexpr int RUNS_NUM = 5;
+
+long handledEvents = 0;
+
+double measureRawEpoll(const std::vector<int> &fds) {
+    const int epollFd = epoll_create1(0);
+    for (int fd: fds) {
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP;
+        event.data.fd = fd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+    }
+
+    std::vector<epoll_event> events(SOCKETS_NUM);
+    long eventsNum = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < PASSES_NUM; pass++) {
+        const int readyNum = epoll_wait(epollFd, events.data(), SOCKETS_NUM, -1);
+        for (int i = 0; i < readyNum; i++) {
+            // The two ready types, EPOLLIN and EPOLLOUT, count as two events as in the Epoll loop
+            eventsNum += __builtin_popcount(events[i].events & (EPOLLIN | EPOLLOUT));
+        }
+    }
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    close(epollFd);
+    return elapsed.count() / double(eventsNum);
+}
+
+template<typename EpollType>
+double measureEpoll(EpollType &epoll, const std::vector<int> &fds) {
+    const auto onEvent = [](int) { handledEvents++; };
+    for (int fd: fds) {
+        epoll.addDescriptor(fd);
+        for (uint32_t eventType: {EPOLLIN, EPOLLOUT, EPOLLRDHUP, EPOLLHUP, EPOLLERR}) {
+            epoll.addEventHandler(fd, eventType, onEvent);
+        }
+    }
+
+    // Lets the adaptive batch grow to the number of sockets first
+    for (int pass = 0; pass < 100; pass++) {
+        epoll.waitForEvents();
+    }
+
+    handledEvents = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < PASSES_NUM; pass++) {
+        epoll.waitForEvents();
+    }
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+    for (int fd: fds) {
+        epoll.removeDescriptor(fd);
+    }
+    return elapsed.count() / double(handledEvents);
+}
+
+}
+
+int main() {
+    std::vector<int> peerFds;
+    std::vector<int> fds;
+    for (int i = 0; i < SOCKETS_NUM; i++) {
+        int pair[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, pair) == -1) {
+            std::perror("socketpair");
+            return 1;
+        }
+        (void) !write(pair[0], "x", 1);
+        peerFds.push_back(pair[0]);
+        fds.push_back(pair[1]);
+    }
+
+    double rawNs = 1e9;
+    double epollNs = 1e9;
+    double levelTriggeredNs = 1e9;
+    for (int run = 0; run < RUNS_NUM; run++) {
+        rawNs = std::min(rawNs, measureRawEpoll(fds));
+        Epoll epoll{false};
+        epollNs = std::min(epollNs, measureEpoll(epoll, fds));
+        LevelTriggeredEpoll levelTriggeredEpoll{};
+        levelTriggeredNs = std::min(levelTriggeredNs, measureEpoll(levelTriggeredEpoll, fds));
+    }
+    std::printf("%d sockets, %d passes, 2 of 5 handlers fire per socket\n", SOCKETS_NUM, PASSES_NUM);
+    std::printf("raw epoll_wait        %6.1f ns/event\n", rawNs);
+    std::printf("Epoll::waitForEvents  %6.1f ns/event\n", epollNs);
+    std::printf("dispatch              %6.1f ns/event\n", epollNs - rawNs);
+    std::printf("LevelTriggeredEpoll   %6.1f ns/event (dispatch %.1f)\n", levelTriggeredNs, levelTriggeredNs - rawNs);
+
+    for (int i = 0; i < SOCKETS_NUM; i++) {
+        close(peerFds[i]);
+        close(fds[i]);
+    }
+    return 0;
+}
@@ -0,0 +1,116 @@
+/**
+ * Dispatch and registration cost of the three kinds of event handlers: a plain function with a context pointer,
+ * a small lambda stored inline, and a std::function, which doesn't fit inline and is heap allocated by EventHandler::allocate().
+ * Level triggered sockets stay readable, so every waitForEvents() pass calls the handler of each of them.
+ * The best of several runs is printed, the single runs are noisy.
+ */
+#include "Epoll.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+constexpr int SOCKETS_NUM = 1000;
+constexpr int PASSES_NUM = 2000;
+constexpr int REGISTRATIONS_NUM = 1000000;
+constexpr int RUNS_NUM = 5;
+
+struct Counter {
+    long events = 0;
+};
+
+void onReadable(int, void *context) {
+    static_cast<Counter *>(context)->events++;
+}
+
+struct Result {
+    double dispatchNs = 1e9;
+    double registrationNs = 1e9;
+};
+
+template<typename AddHandler>
+void measure(const std::vector<int> &fds, AddHandler addHandler, Result &result) {
+    Counter counter;
+    Epoll epoll{false};
+    for (int fd: fds) {
+        epoll.addDescriptor(fd);
+        addHandler(epoll, fd, counter);
+    }
+
+    // Lets the adaptive batch grow to the number of sockets first
+    for (int pass = 0; pass < 100; pass++) {
+        epoll.waitForEvents();
+    }
+
+    counter.events = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < PASSES_NUM; pass++) {
+        epoll.waitForEvents();
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    result.dispatchNs = std::min(result.dispatchNs, elapsed.count() / double(counter.events));
+
+    // Replacing the handler of a registered fd, each replacement includes its epoll_ctl(EPOLL_CTL_MOD) call
+    const int fd = fds.front();
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < REGISTRATIONS_NUM; i++) {
+        addHandler(epoll, fd, counter);
+    }
+    elapsed = std::chrono::steady_clock::now() - start;
+    result.registrationNs = std::min(result.registrationNs, elapsed.count() / REGISTRATIONS_NUM);
+
+    for (int monitoredFd: fds) {
+        epoll.removeDescriptor(monitoredFd);
+    }
+}
+
+}
+
+int main() {
+    std::vector<int> peerFds;
+    std::vector<int> fds;
+    for (int i = 0; i < SOCKETS_NUM; i++) {
+        int pair[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, pair) == -1) {
+            std::perror("socketpair");
+            return 1;
+        }
+        (void) !write(pair[0], "x", 1);
+        peerFds.push_back(pair[0]);
+        fds.push_back(pair[1]);
+    }
+
+    Result functionPointer;
+    Result lambda;
+    Result stdFunction;
+    for (int run = 0; run < RUNS_NUM; run++) {
+        measure(fds, [](Epoll &epoll, int fd, Counter &counter) {
+            epoll.addEventHandler(fd, EPOLLIN, &onReadable, &counter);
+        }, functionPointer);
+        measure(fds, [](Epoll &epoll, int fd, Counter &counter) {
+            epoll.addEventHandler(fd, EPOLLIN, [&counter](int) { counter.events++; });
+        }, lambda);
+        measure(fds, [](Epoll &epoll, int fd, Counter &counter) {
+            epoll.addEventHandler(fd, EPOLLIN, EventHandler::allocate(std::function<void(int)>([&counter](int) { counter.events++; })));
+        }, stdFunction);
+    }
+
+    std::printf("%d sockets, %d passes, handler replaced %d times\n", SOCKETS_NUM, PASSES_NUM, REGISTRATIONS_NUM);
+    std::printf("%-24s %6.1f ns/event (incl. epoll_wait)  %6.1f ns/registration\n", "function + context",
+                functionPointer.dispatchNs, functionPointer.registrationNs);
+    std::printf("%-24s %6.1f ns/event (incl. epoll_wait)  %6.1f ns/registration\n", "inline lambda",
+                lambda.dispatchNs, lambda.registrationNs);
+    std::printf("%-24s %6.1f ns/event (incl. epoll_wait)  %6.1f ns/registration\n", "std::function (heap)",
+                stdFunction.dispatchNs, stdFunction.registrationNs);
+
+    for (int i = 0; i < SOCKETS_NUM; i++) {
+        close(peerFds[i]);
+        close(fds[i]);
+    }
+    return 0;
+}
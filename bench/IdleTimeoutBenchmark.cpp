@@ -0,0 +1,94 @@
+/**
+ * 1M idle timeouts with a 99% reset rate, the timing wheel of Epoll::addTimeout() against the binary heap of Epoll::addTimer().
+ * Every operation picks a random connection: 99% of them reset its idle timeout (a read arrived), 1% close the connection
+ * and open a new one (cancel and add). The loop is advanced every 1000 operations, as a waitForEvents() pass would do.
+ * The heap has no reset, the timer is added again under the same id and the outdated entry is skipped once it reaches the top.
+ */
+#include "TimerQueue.h"
+#include "TimingWheel.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr int TIMEOUTS_NUM = 1000000;
+constexpr int OPERATIONS_NUM = 10000000;
+constexpr int OPERATIONS_PER_PASS = 1000;
+constexpr auto IDLE_TIMEOUT = std::chrono::seconds(30);
+
+long expiredNum = 0;
+
+double benchmarkWheel(const std::vector<uint32_t> &connections, const std::vector<uint32_t> &operations) {
+    TimingWheel wheel;
+    std::vector<TimingWheel::TimeoutId> ids(TIMEOUTS_NUM);
+    for (int i = 0; i < TIMEOUTS_NUM; i++) {
+        ids[i] = wheel.add(IDLE_TIMEOUT, [] { expiredNum++; });
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < OPERATIONS_NUM; i++) {
+        const uint32_t connection = connections[i];
+        if (operations[i] != 0) {
+            wheel.reset(ids[connection], IDLE_TIMEOUT);
+        } else {
+            wheel.cancel(ids[connection]);
+            ids[connection] = wheel.add(IDLE_TIMEOUT, [] { expiredNum++; });
+        }
+
+        if (i % OPERATIONS_PER_PASS == 0) {
+            wheel.advance(TimingWheel::Clock::now());
+        }
+    }
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / OPERATIONS_NUM;
+}
+
+double benchmarkHeap(const std::vector<uint32_t> &connections, const std::vector<uint32_t> &operations) {
+    TimerQueue queue;
+    std::vector<TimerQueue::TimerId> ids(TIMEOUTS_NUM);
+    TimerQueue::TimerId nextId = 1;
+    for (int i = 0; i < TIMEOUTS_NUM; i++) {
+        ids[i] = nextId++;
+        queue.add(ids[i], TimerQueue::Clock::now() + IDLE_TIMEOUT, TimerQueue::Clock::duration::zero(), [] { expiredNum++; });
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < OPERATIONS_NUM; i++) {
+        const uint32_t connection = connections[i];
+        if (operations[i] == 0) {
+            queue.cancel(ids[connection]);
+            ids[connection] = nextId++;
+        }
+        queue.add(ids[connection], TimerQueue::Clock::now() + IDLE_TIMEOUT, TimerQueue::Clock::duration::zero(), [] { expiredNum++; });
+
+        if (i % OPERATIONS_PER_PASS == 0) {
+            queue.runExpired(TimerQueue::Clock::now());
+        }
+    }
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / OPERATIONS_NUM;
+}
+
+}
+
+int main() {
+    std::mt19937 random{42};
+    std::uniform_int_distribution<uint32_t> connectionDistribution{0, TIMEOUTS_NUM - 1};
+    std::uniform_int_distribution<uint32_t> operationDistribution{0, 99};
+
+    // Generated up front, so both structures get the same operations and the generator isn't measured
+    std::vector<uint32_t> connections(OPERATIONS_NUM);
+    std::vector<uint32_t> operations(OPERATIONS_NUM);
+    for (int i = 0; i < OPERATIONS_NUM; i++) {
+        connections[i] = connectionDistribution(random);
+        operations[i] = operationDistribution(random);
+    }
+
+    std::printf("%d timeouts, %d operations (99%% reset, 1%% cancel and add)\n", TIMEOUTS_NUM, OPERATIONS_NUM);
+    std::printf("%-26s %6.1f ns/operation\n", "timing wheel", benchmarkWheel(connections, operations));
+    std::printf("%-26s %6.1f ns/operation\n", "binary heap (TimerQueue)", benchmarkHeap(connections, operations));
+    std::printf("expired %ld (expected 0)\n", expiredNum);
+    return 0;
+}
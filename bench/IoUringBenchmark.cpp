@@ -0,0 +1,155 @@
+/**
+ * Syscalls per event and round trip latency of the epoll and the io_uring backends.
+ * Every socket pair bounces a small message, the client side measures the time from its write until the echo arrives.
+ * The syscalls of the library (epoll_wait(), epoll_ctl() and io_uring_enter() through syscall()) are counted by wrapping
+ * the symbols at link time (see CMakeLists.txt), the reads and writes of the handlers aren't part of the count.
+ */
+#include "Epoll.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <exception>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace {
+
+long librarySyscallsNum = 0;
+
+}
+
+extern "C" {
+
+long __real_syscall(long number, ...);
+
+int __real_epoll_wait(int epollFd, epoll_event *events, int maxEvents, int timeout);
+
+int __real_epoll_ctl(int epollFd, int operation, int fd, epoll_event *event);
+
+long __wrap_syscall(long number, ...) {
+    va_list arguments;
+    va_start(arguments, number);
+    long values[6];
+    for (long &value: values) {
+        value = va_arg(arguments, long);
+    }
+    va_end(arguments);
+
+    librarySyscallsNum++;
+    return __real_syscall(number, values[0], values[1], values[2], values[3], values[4], values[5]);
+}
+
+int __wrap_epoll_wait(int epollFd, epoll_event *events, int maxEvents, int timeout) {
+    librarySyscallsNum++;
+    return __real_epoll_wait(epollFd, events, maxEvents, timeout);
+}
+
+int __wrap_epoll_ctl(int epollFd, int operation, int fd, epoll_event *event) {
+    librarySyscallsNum++;
+    return __real_epoll_ctl(epollFd, operation, fd, event);
+}
+
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Client {
+    Clock::time_point sentAt;
+    int roundsLeft = 0;
+};
+
+long handledEvents = 0;
+std::vector<double> latencies;
+
+void onServerReadable(int fd, void *) {
+    handledEvents++;
+    char buffer[64];
+    ssize_t size;
+    while ((size = read(fd, buffer, sizeof(buffer))) > 0) {
+        (void) !write(fd, buffer, size);
+    }
+}
+
+void onClientReadable(int fd, void *context) {
+    handledEvents++;
+    Client &client = *static_cast<Client *>(context);
+    char buffer[64];
+    while (read(fd, buffer, sizeof(buffer)) > 0) {}
+
+    latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - client.sentAt).count());
+    if (--client.roundsLeft > 0) {
+        client.sentAt = Clock::now();
+        (void) !write(fd, "ping", 4);
+    }
+}
+
+void runBenchmark(EpollBackend backend, bool isEdgeTriggered, int pairsNum, int roundsNum) {
+    Epoll epoll{isEdgeTriggered, Epoll::DEFAULT_BATCH_SIZE, Epoll::DEFAULT_MAX_BATCH_SIZE, backend};
+    std::vector<Client> clients(pairsNum);
+    std::vector<int> fds;
+
+    for (Client &client: clients) {
+        int pair[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, pair) == -1) {
+            std::perror("socketpair");
+            return;
+        }
+        fds.push_back(pair[0]);
+        fds.push_back(pair[1]);
+        client.roundsLeft = roundsNum;
+        epoll.addDescriptor(pair[0]);
+        epoll.addEventHandler(pair[0], EPOLLIN, &onClientReadable, &client);
+        epoll.addDescriptor(pair[1]);
+        epoll.addEventHandler(pair[1], EPOLLIN, &onServerReadable, nullptr);
+    }
+
+    latencies.clear();
+    latencies.reserve(size_t(pairsNum) * roundsNum);
+    handledEvents = 0;
+    const long startSyscallsNum = librarySyscallsNum;
+    const auto start = Clock::now();
+
+    for (int i = 0; i < pairsNum; i++) {
+        clients[i].sentAt = Clock::now();
+        (void) !write(fds[size_t(i) * 2], "ping", 4);
+    }
+    const size_t expectedRoundTrips = size_t(pairsNum) * roundsNum;
+    while (latencies.size() < expectedRoundTrips) {
+        epoll.waitForEvents(100);
+    }
+
+    const std::chrono::duration<double> elapsed = Clock::now() - start;
+    std::sort(latencies.begin(), latencies.end());
+    std::printf("%-8s %s %4d pairs  syscalls/event %.3f  p50 %6.1f us  p99 %6.1f us  %.2f M events/s\n",
+                backend == EpollBackend::IO_URING ? "io_uring" : "epoll", isEdgeTriggered ? "ET" : "LT", pairsNum,
+                double(librarySyscallsNum - startSyscallsNum) / double(handledEvents), latencies[latencies.size() / 2],
+                latencies[latencies.size() * 99 / 100], double(handledEvents) / elapsed.count() / 1e6);
+
+    for (int fd: fds) {
+        epoll.removeDescriptor(fd);
+        close(fd);
+    }
+}
+
+}
+
+int main() {
+    try {
+        for (const auto &[pairsNum, roundsNum]: {std::pair{1, 100000}, std::pair{64, 2000}, std::pair{1024, 200}}) {
+            for (const bool isEdgeTriggered: {false, true}) {
+                runBenchmark(EpollBackend::EPOLL, isEdgeTriggered, pairsNum, roundsNum);
+                runBenchmark(EpollBackend::IO_URING, isEdgeTriggered, pairsNum, roundsNum);
+            }
+        }
+    } catch (const std::exception &exception) {
+        // io_uring can be missing or disabled (kernel.io_uring_disabled)
+        std::printf("%s\n", exception.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,94 @@
+/**
+ * Throughput of EpollReactorPool with 1 to 32 reactors. Every reactor runs its own set of socket pairs which bounce a byte
+ * between their two ends, so the reactors share nothing and the throughput should grow with the number of cores.
+ * More reactors than cores can't scale, the number of cores is printed with the results.
+ */
+#include "EpollReactorPool.h"
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+constexpr int PAIRS_PER_REACTOR = 64;
+constexpr auto RUN_DURATION = std::chrono::milliseconds(500);
+
+// Padded to a cache line, every reactor thread updates only its own counter
+struct alignas(64) Counter {
+    long messages = 0;
+};
+
+void onReadable(int fd, void *context) {
+    char byte;
+    if (read(fd, &byte, 1) == 1) {
+        static_cast<Counter *>(context)->messages++;
+        (void) !write(fd, &byte, 1);
+    }
+}
+
+double runBenchmark(size_t reactorsNum) {
+    std::vector<int> fds;
+    std::unique_ptr<Counter[]> counters{new Counter[reactorsNum]};
+    double messagesPerSecond = 0;
+
+    {
+        EpollReactorPool pool{reactorsNum, false};
+        for (size_t reactorIndex = 0; reactorIndex < reactorsNum; reactorIndex++) {
+            for (int i = 0; i < PAIRS_PER_REACTOR; i++) {
+                int pair[2];
+                if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, pair) == -1) {
+                    std::perror("socketpair");
+                    return 0;
+                }
+                fds.push_back(pair[0]);
+                fds.push_back(pair[1]);
+
+                Counter *counter = &counters[reactorIndex];
+                pool.post(reactorIndex, [pair0 = pair[0], pair1 = pair[1], counter](Epoll &epoll) {
+                    for (int fd: {pair0, pair1}) {
+                        epoll.addDescriptor(fd);
+                        epoll.addEventHandler(fd, EPOLLIN, &onReadable, counter);
+                    }
+                    (void) !write(pair0, "x", 1);
+                });
+            }
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        pool.start();
+        std::this_thread::sleep_for(RUN_DURATION);
+        pool.stop();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        long messages = 0;
+        for (size_t i = 0; i < reactorsNum; i++) {
+            messages += counters[i].messages;
+        }
+        messagesPerSecond = double(messages) / elapsed.count();
+    }
+
+    for (int fd: fds) {
+        close(fd);
+    }
+    return messagesPerSecond;
+}
+
+}
+
+int main() {
+    std::printf("%u cores, %d socket pairs per reactor\n", std::thread::hardware_concurrency(), PAIRS_PER_REACTOR);
+
+    double singleReactor = 0;
+    for (size_t reactorsNum = 1; reactorsNum <= 32; reactorsNum *= 2) {
+        const double messagesPerSecond = runBenchmark(reactorsNum);
+        if (reactorsNum == 1) {
+            singleReactor = messagesPerSecond;
+        }
+        std::printf("%2zu reactors  %10.0f messages/s  %5.2fx\n", reactorsNum, messagesPerSecond, messagesPerSecond / singleReactor);
+    }
+    return 0;
+}
@@ -0,0 +1,115 @@
+/**
+ * Wakeups per accepted connection with 16 threads, each running its own Epoll, watching one shared listening socket.
+ * Without DESCRIPTOR_EXCLUSIVE every connection wakes up all of the threads and most of them find nothing to accept,
+ * with it the kernel wakes up only one of them. The connections are made one at a time, so that the threads are asleep.
+ * A thread woken up for a connection which another thread already accepted usually goes back to sleep inside of epoll_wait(),
+ * so the wakeups are counted as the voluntary context switches of the threads (getrusage(RUSAGE_THREAD)).
+ */
+#include "Epoll.h"
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+constexpr int THREADS_NUM = 16;
+constexpr int CONNECTIONS_NUM = 2000;
+
+std::atomic<long> wakeupsNum{0};
+std::atomic<long> handlerCallsNum{0};
+std::atomic<long> acceptedNum{0};
+
+long getContextSwitchesNum() {
+    rusage usage{};
+    getrusage(RUSAGE_THREAD, &usage);
+    return usage.ru_nvcsw;
+}
+
+void onListenerReady(int listenerFd, void *) {
+    handlerCallsNum.fetch_add(1, std::memory_order_relaxed);
+    for (;;) {
+        const int clientFd = accept4(listenerFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (clientFd == -1)
+            return;
+
+        acceptedNum.fetch_add(1, std::memory_order_relaxed);
+        close(clientFd);
+    }
+}
+
+void runBenchmark(const char *name, uint32_t options) {
+    const int listenerFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addressLen = sizeof(address);
+    if (bind(listenerFd, (sockaddr *) &address, addressLen) != 0 || listen(listenerFd, SOMAXCONN) != 0) {
+        std::perror("listen");
+        return;
+    }
+    getsockname(listenerFd, (sockaddr *) &address, &addressLen);
+
+    wakeupsNum = 0;
+    handlerCallsNum = 0;
+    acceptedNum = 0;
+    std::atomic<bool> isStopped{false};
+    std::atomic<int> readyThreadsNum{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < THREADS_NUM; i++) {
+        threads.emplace_back([&] {
+            Epoll epoll{false};
+            epoll.addDescriptor(listenerFd, options);
+            epoll.addEventHandler(listenerFd, EPOLLIN, &onListenerReady, nullptr);
+            readyThreadsNum++;
+
+            // The timeout only checks the stop flag, its wakeups are a small part of the count
+            const long initialContextSwitchesNum = getContextSwitchesNum();
+            while (!isStopped.load()) {
+                epoll.waitForEvents(100);
+            }
+            wakeupsNum += getContextSwitchesNum() - initialContextSwitchesNum;
+            epoll.removeDescriptor(listenerFd);
+        });
+    }
+    while (readyThreadsNum.load() < THREADS_NUM) {
+        std::this_thread::yield();
+    }
+
+    for (int i = 0; i < CONNECTIONS_NUM; i++) {
+        const int clientFd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (connect(clientFd, (sockaddr *) &address, addressLen) != 0) {
+            std::perror("connect");
+        }
+        close(clientFd);
+
+        // Waits until the connection is accepted, so that every connection finds the threads waiting
+        while (acceptedNum.load() <= i) {
+            std::this_thread::yield();
+        }
+    }
+
+    isStopped = true;
+    for (auto &thread: threads) {
+        thread.join();
+    }
+    close(listenerFd);
+
+    std::printf("%-24s wakeups/accepted connection %5.2f  handler calls/accepted connection %.2f\n", name,
+                double(wakeupsNum.load()) / double(acceptedNum.load()), double(handlerCallsNum.load()) / double(acceptedNum.load()));
+}
+
+}
+
+int main() {
+    std::printf("%d threads sharing one listener, %d connections\n", THREADS_NUM, CONNECTIONS_NUM);
+    runBenchmark("shared", 0);
+    runBenchmark("DESCRIPTOR_EXCLUSIVE", DESCRIPTOR_EXCLUSIVE);
+    return 0;
+}
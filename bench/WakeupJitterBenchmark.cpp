@@ -0,0 +1,49 @@
+/**
+ * Wake-up accuracy of waitForEvents() with nothing to wait for, the nanosecond overload (epoll_pwait2() or its fallback)
+ * against the millisecond overload, which has to round a sub-millisecond timeout up to a whole millisecond.
+ * Prints how late the call returned compared to the requested timeout, the median and the 99th percentile.
+ */
+#include "Epoll.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+constexpr int SAMPLES_NUM = 500;
+
+using Microseconds = std::chrono::duration<double, std::micro>;
+
+template<typename Wait>
+std::vector<double> measureLateness(std::chrono::nanoseconds requested, Wait wait) {
+    std::vector<double> lateness;
+    lateness.reserve(SAMPLES_NUM);
+    for (int i = 0; i < SAMPLES_NUM; i++) {
+        const auto start = std::chrono::steady_clock::now();
+        wait();
+        lateness.push_back(Microseconds(std::chrono::steady_clock::now() - start - requested).count());
+    }
+    std::sort(lateness.begin(), lateness.end());
+    return lateness;
+}
+
+}
+
+int main() {
+    Epoll epoll{false};
+    std::printf("late by (us)           nanoseconds overload     milliseconds overload\n");
+
+    for (const std::chrono::nanoseconds requested: {std::chrono::nanoseconds(50000), std::chrono::nanoseconds(200000),
+                                                    std::chrono::nanoseconds(1500000)}) {
+        const int requestedMs = int(std::chrono::ceil<std::chrono::milliseconds>(requested).count());
+
+        const std::vector<double> precise = measureLateness(requested, [&] { epoll.waitForEvents(requested); });
+        const std::vector<double> coarse = measureLateness(requested, [&] { epoll.waitForEvents(requestedMs); });
+
+        std::printf("%6.0f us timeout      p50 %7.1f  p99 %7.1f    p50 %7.1f  p99 %7.1f (%d ms)\n",
+                    Microseconds(requested).count(), precise[SAMPLES_NUM / 2], precise[SAMPLES_NUM * 99 / 100],
+                    coarse[SAMPLES_NUM / 2], coarse[SAMPLES_NUM * 99 / 100], requestedMs);
+    }
+    return 0;
+}
@@ -0,0 +1,198 @@
+#include "Connection.h"
+#include <cerrno>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <utility>
+
+template<typename Traits>
+BasicConnection<Traits>::BasicConnection(BasicEpoll<Traits> &epoll, int fd, DataHandler onData, CloseHandler onClose)
+        : _epoll(epoll), _fd(fd), _onData(std::move(onData)), _onClose(std::move(onClose)), _input(&epoll._bufferPool),
+          _output(&epoll._bufferPool) {}
+
+// # Connection class public interface
+// ######################################################################################################################
+
+template<typename Traits>
+void BasicConnection<Traits>::write(const void *data, size_t size) {
+    if (_isClosed || size == 0)
+        return;
+
+    const char *remaining = static_cast<const char *>(data);
+
+    // Nothing is queued, so the data can go straight to the socket without a copy
+    if (_output.empty() && !_isWritePending) {
+        while (size > 0) {
+            const ssize_t status = send(_fd, remaining, size, MSG_DONTWAIT | MSG_NOSIGNAL);
+            if (status > 0) {
+                remaining += status;
+                size -= status;
+                continue;
+            }
+            if (status == -1 && errno == EINTR)
+                continue;
+
+            // A failed socket is reported by the next writable event, the connection is closed from there
+            break;
+        }
+    }
+
+    _output.append(remaining, size);
+    if (!_output.empty() && !_isWritePending) {
+        _awaitWritable();
+    }
+}
+
+template<typename Traits>
+void BasicConnection<Traits>::close() {
+    if (_isClosed)
+        return;
+
+    _isClosing = true;
+    if (_output.empty()) {
+        _close(0);
+    }
+}
+
+// # Connection class private members
+// ######################################################################################################################
+
+template<typename Traits>
+void BasicConnection<Traits>::_awaitReadable() {
+    // The descriptor could have been removed from Epoll directly by a handler
+    if (_epoll._findConnection(_fd) != this)
+        return;
+
+    _epoll._awaitReadiness(_fd, EPOLLIN, AsyncIoHandler(&BasicConnection::_onReadReady, this));
+}
+
+template<typename Traits>
+void BasicConnection<Traits>::_awaitWritable() {
+    if (_epoll._findConnection(_fd) != this)
+        return;
+
+    _isWritePending = true;
+    _epoll._awaitReadiness(_fd, EPOLLOUT, AsyncIoHandler(&BasicConnection::_onWriteReady, this));
+}
+
+template<typename Traits>
+void BasicConnection<Traits>::_onReadable() {
+    if (_isClosing)
+        return;
+
+    const size_t previousSize = _input.size();
+    bool isEndOfStream = false;
+    int error = 0;
+
+    for (;;) {
+        _input.reserve(MIN_READ_SIZE);
+
+        iovec spans[2];
+        msghdr message{};
+        message.msg_iov = spans;
+        message.msg_iovlen = _input.getWritableSpans(spans);
+        const size_t requested = _input.getFreeSize();
+
+        const ssize_t status = recvmsg(_fd, &message, MSG_DONTWAIT);
+        if (status > 0) {
+            _input.commit(status);
+            // A short read emptied the socket. In level triggered mode the kernel reports the rest of the data again.
+            if (static_cast<size_t>(status) < requested || !_epoll.isEdgeTriggered())
+                break;
+            continue;
+        }
+
+        if (status == 0) {
+            isEndOfStream = true;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            error = errno;
+        }
+        break;
+    }
+
+    if (_input.size() > previousSize) {
+        _onData(*this);
+        // The handler could have closed the connection
+        if (_isClosed)
+            return;
+    }
+
+    if (error != 0) {
+        _close(error);
+    } else if (isEndOfStream) {
+        // The peer can still receive, whatever the handler wrote is flushed first
+        close();
+    } else if (!_isClosing) {
+        _awaitReadable();
+    }
+}
+
+template<typename Traits>
+void BasicConnection<Traits>::_onWritable() {
+    _isWritePending = false;
+    if (_isClosed || !_flush())
+        return;
+
+    if (!_output.empty()) {
+        _awaitWritable();
+    } else if (_isClosing) {
+        _close(0);
+    }
+}
+
+template<typename Traits>
+bool BasicConnection<Traits>::_flush() {
+    while (!_output.empty()) {
+        iovec spans[2];
+        msghdr message{};
+        message.msg_iov = spans;
+        message.msg_iovlen = _output.getReadableSpans(spans);
+
+        const ssize_t status = sendmsg(_fd, &message, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (status >= 0) {
+            _output.consume(status);
+            continue;
+        }
+        if (errno == EINTR)
+            continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return true;
+
+        _close(errno);
+        return false;
+    }
+    return true;
+}
+
+template<typename Traits>
+void BasicConnection<Traits>::_close(int error) {
+    if (_isClosed)
+        return;
+
+    _isClosed = true;
+    _isClosing = true;
+    _output.clear();
+    if (_onClose != nullptr) {
+        _onClose(*this, error);
+    }
+
+    // Outside of a waitForEvents() pass the removal destroys this instance right away
+    const int fd = _fd;
+    _epoll.removeDescriptor(fd);
+    ::close(fd);
+}
+
+template<typename Traits>
+void BasicConnection<Traits>::_onReadReady(int, ssize_t, void *context) {
+    static_cast<BasicConnection *>(context)->_onReadable();
+}
+
+template<typename Traits>
+void BasicConnection<Traits>::_onWriteReady(int, ssize_t, void *context) {
+    static_cast<BasicConnection *>(context)->_onWritable();
+}
+
+template class BasicConnection<DefaultEpollTraits>;
+template class BasicConnection<LevelTriggeredEpollTraits>;
+template class BasicConnection<EdgeTriggeredEpollTraits>;
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "Epoll.h"
+#include "RingBuffer.h"
+#include <cstddef>
+#include <string_view>
+#include <sys/types.h>
+
+/**
+ * Buffered stream socket of one Epoll instance, created by Epoll::addConnection() and owned by the loop.
+ * Incoming data is read into a growable input ring buffer and the data handler is called to consume it (see getInput()).
+ * write() sends right away while the socket accepts the data, the rest is queued in the output buffer and flushed once the socket
+ * is writable again. Epoll listens for EPOLLOUT only while some output is queued, so a connection causes no busy writable wakeups.
+ * Both buffers allocate on first use and keep their storage. Their initial blocks, like the connection itself, come from the slab
+ * pools of Epoll, so a connection which never needs bigger buffers doesn't touch the global allocator once the pools warm up.
+ * All methods must be called on the epoll thread. The Traits are the ones of the owning BasicEpoll, Connection uses the default ones.
+ */
+template<typename Traits>
+class BasicConnection {
+public:
+    using DataHandler = BasicConnectionDataHandler<Traits>;
+    using CloseHandler = BasicConnectionCloseHandler<Traits>;
+
+    /**
+     * Use Epoll::addConnection() instead, it starts the reading
+     */
+    BasicConnection(BasicEpoll<Traits> &epoll, int fd, DataHandler onData, CloseHandler onClose);
+
+    // Async operations of the loop point to the instance, it can't be copied
+    BasicConnection(const BasicConnection &) = delete;
+
+    BasicConnection &operator=(const BasicConnection &) = delete;
+
+    /**
+     * Queues the data and sends as much of it as possible. Does nothing once the connection is closed.
+     */
+    void write(const void *data, size_t size);
+
+    void write(std::string_view data) { write(data.data(), data.size()); }
+
+    /**
+     * Closes the connection once the queued output is flushed. Nothing is read anymore, the close handler is called and the fd is
+     * removed from Epoll and closed. The connection (and the reference to it) is valid until the current waitForEvents() pass ends.
+     */
+    void close();
+
+    /**
+     * Data which was read and not consumed yet, the data handler usually consumes it by read() or consume()
+     */
+    RingBuffer &getInput() { return _input; }
+
+    /**
+     * Number of bytes written by write() which the socket didn't accept yet
+     */
+    size_t getQueuedOutputSize() const { return _output.size(); }
+
+    int getFd() const { return _fd; }
+
+    BasicEpoll<Traits> &getEpoll() { return _epoll; }
+
+    /**
+     * close() was called or the peer closed its side, the connection closes once the output is flushed
+     */
+    bool isClosing() const { return _isClosing; }
+
+private:
+    // Reads are never smaller than this, the input buffer grows if it has less free space
+    static constexpr size_t MIN_READ_SIZE = 4096;
+
+    BasicEpoll<Traits> &_epoll;
+    const int _fd;
+    const DataHandler _onData;
+    const CloseHandler _onClose;
+    RingBuffer _input;
+    RingBuffer _output;
+    // A writable readiness of the fd is awaited by Epoll
+    bool _isWritePending = false;
+    bool _isClosing = false;
+    bool _isClosed = false;
+
+    /**
+     * Waits for the next EPOLLIN (the readiness only, the connection reads by itself)
+     */
+    void _awaitReadable();
+
+    void _awaitWritable();
+
+    /**
+     * Reads everything available, calls the data handler, then waits for more data
+     */
+    void _onReadable();
+
+    /**
+     * Sends the queued output, closes the connection if it's closing and the output is flushed
+     */
+    void _onWritable();
+
+    /**
+     * Sends the queued output until the socket is full
+     * @return false if the socket failed, the connection is then closed
+     */
+    bool _flush();
+
+    /**
+     * Calls the close handler and removes and closes the fd, the error is 0 for a regular close
+     */
+    void _close(int error);
+
+    static void _onReadReady(int fd, ssize_t result, void *context);
+
+    static void _onWriteReady(int fd, ssize_t result, void *context);
+
+    friend BasicEpoll<Traits>;
+};
+
+extern template class BasicConnection<DefaultEpollTraits>;
+extern template class BasicConnection<LevelTriggeredEpollTraits>;
+extern template class BasicConnection<EdgeTriggeredEpollTraits>;
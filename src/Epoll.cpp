@@ -1,177 +1,1095 @@
 #include "Epoll.h"
+#include "Connection.h"
+#include <algorithm>
+#include <cerrno>
 #include <fcntl.h>
 #include <stdexcept>
+#include <string>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/signalfd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
 #include <unistd.h>
 #include <utility>
 
-Epoll::Epoll(bool isEdgeTriggered) : _epollFd(epoll_create1(0)), _isEdgeTriggered(isEdgeTriggered) {
-    if (_epollFd == -1) {
+template<typename Traits>
+BasicEpoll<Traits>::BasicEpoll(ConstructorTag, bool isEdgeTriggered, int initialBatchSize, int maxBatchSize, EpollBackend backend)
+        : _connectionPool(sizeof(Connection), alignof(Connection)),
+          _epollFd(backend == EpollBackend::EPOLL ? epoll_create1(0) : -1), _backend(backend), _isEdgeTriggered(isEdgeTriggered),
+          _triggerModeEvents(isEdgeTriggered ? uint32_t(EPOLLET) : 0u), _minBatchSize(initialBatchSize), _maxBatchSize(maxBatchSize),
+          _batchSize(initialBatchSize) {
+    if (backend == EpollBackend::EPOLL && _epollFd == -1) {
         throw std::runtime_error("Epoll::Epoll: ERROR - Failed to create epoll file descriptor.");
     }
 
-    _eventsVector.reserve(_maxEventsNum * sizeof(epoll_event));
+    if (initialBatchSize <= 0 || maxBatchSize < initialBatchSize) {
+        if (_epollFd != -1) close(_epollFd);
+        throw std::runtime_error("Epoll::Epoll: ERROR - Batch size must be positive and initialBatchSize must not exceed maxBatchSize.");
+    }
+
+    if (Traits::batchSize != 0 && (initialBatchSize != Traits::batchSize || maxBatchSize != Traits::batchSize)) {
+        if (_epollFd != -1) close(_epollFd);
+        throw std::runtime_error("Epoll::Epoll: ERROR - The batch size is fixed by the traits, the batch sizes must be left at their defaults.");
+    }
+
+    if (backend == EpollBackend::IO_URING) {
+        // Room for a few full batches, the kernel keeps completions which don't fit until they are reaped
+        _ioUring = std::make_unique<IoUringPoller>(unsigned(maxBatchSize) * 4, isEdgeTriggered);
+    }
+
+    // epoll_wait() writes directly into this buffer, so it has to hold a whole batch
+    _eventsVector.resize(_batchSize);
+
+    sigemptyset(&_handledSignals);
+    sigemptyset(&_blockedSignals);
+
+    _wakeupFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (_wakeupFd == -1) {
+        if (_epollFd != -1) close(_epollFd);
+        throw std::runtime_error("Epoll::Epoll: ERROR - Failed to create wakeup eventfd.");
+    }
+
+    try {
+        _epollCtlAdd(_wakeupFd, EPOLLIN, DescriptorTable::makeEventToken(_wakeupFd, DescriptorTable::INTERNAL_GENERATION));
+    } catch (...) {
+        close(_wakeupFd);
+        if (_epollFd != -1) close(_epollFd);
+        throw;
+    }
 }
 
-Epoll::~Epoll() {
-    close(_epollFd);
+template<typename Traits>
+BasicEpoll<Traits>::~BasicEpoll() {
+    if (_signalFd != -1) {
+        pthread_sigmask(SIG_UNBLOCK, &_blockedSignals, nullptr);
+        close(_signalFd);
+    }
+    close(_wakeupFd);
+    if (_epollFd != -1) close(_epollFd);
 }
 
 // # Epoll class public interface
 // ######################################################################################################################
 
-void Epoll::addDescriptor(int fd) {
-    _monitoredFds.try_emplace(fd, fd);
+template<typename Traits>
+void BasicEpoll<Traits>::addDescriptor(int fd, uint32_t options) {
+    if (_isForeignThread()) {
+        _post([this, fd, options] { addDescriptor(fd, options); });
+        return;
+    }
+
+    MonitoredDescriptor &md = _monitoredFds.emplace(fd);
+
+    const bool isTagged = (options & DESCRIPTOR_TAG_EVENTS) != 0;
+    const bool isExclusive = (options & DESCRIPTOR_EXCLUSIVE) != 0;
+    if (isExclusive && (md.getInterestMask() & ~exclusiveEventTypesMask) != 0) {
+        throw std::runtime_error("Epoll::addDescriptor: ERROR - EPOLLEXCLUSIVE can't be used with EPOLLRDHUP or EPOLLPRI handlers.");
+    }
+
+    if (md.isTagged != isTagged || md.isExclusive != isExclusive) {
+        const bool wasInitialized = md.isInitialized;
+
+        // EPOLLEXCLUSIVE can't be changed by EPOLL_CTL_MOD, the fd has to be registered again
+        if (wasInitialized && md.isExclusive != isExclusive) {
+            _epollCtlDelete(fd);
+            md.isInitialized = false;
+        }
+
+        md.isTagged = isTagged;
+        md.isExclusive = isExclusive;
+        // The kernel must start returning the new token
+        if (wasInitialized)
+            _reloadEventHandlers(md);
+    }
 
-    if (_isEdgeTriggered) {
+    if (isEdgeTriggered()) {
         _setNonBlocking(fd);
     }
 }
 
-void Epoll::removeDescriptor(int monitoredFd) {
-    if (_monitoredFds.count(monitoredFd) != 0) {
-        _epollCtlDelete(monitoredFd);
+template<typename Traits>
+void BasicEpoll<Traits>::removeDescriptor(int monitoredFd) {
+    if (_isForeignThread()) {
+        _post([this, monitoredFd] { removeDescriptor(monitoredFd); });
+        return;
+    }
+
+    if (_monitoredFds.find(monitoredFd) == nullptr)
+        return;
+
+    _epollCtlDelete(monitoredFd);
+
+    if (_isDispatching) {
+        // A handler of this record can be running right now, the slot is freed (and can be reused) but the record lives until the batch ends
+        _retiredDescriptors.push_back(_monitoredFds.detach(monitoredFd));
+    } else {
         _monitoredFds.erase(monitoredFd);
     }
 }
 
-void Epoll::waitForEvents(int timeout) {
-    // Start waiting for descriptor events
-    int numOfEvents = epoll_wait(_epollFd, &_eventsVector[0], _maxEventsNum, timeout);
+template<typename Traits>
+void BasicEpoll<Traits>::waitForEvents(int timeout) {
+    _waitForEvents(timeout < 0 ? Clock::time_point::max() : Clock::now() + std::chrono::milliseconds(timeout));
+}
 
-    for (int i = 0; i < numOfEvents; i++) {
-        uint32_t events = _eventsVector[i].events;
-        int fd = _eventsVector[i].data.fd;
+template<typename Traits>
+void BasicEpoll<Traits>::waitForEvents(std::chrono::nanoseconds timeout) {
+    _waitForEvents(timeout < std::chrono::nanoseconds::zero() ? Clock::time_point::max() : _getDeadline(timeout));
+}
 
-        // Check for all possible event types
-        for (uint32_t evt: allEventTypes) {
-            // The monitored descriptor can be removed during the event handling process, protect against this
-            if (_monitoredFds.count(fd) == 0)
-                return;
+template<typename Traits>
+void BasicEpoll<Traits>::run() {
+    while (_keepRunning()) {
+        _waitForEvents(Clock::time_point::max());
+    }
+}
 
-            // Check if the handler for this event exists
-            if (_monitoredFds.at(fd).hasHandler(events & evt)) {
-                // Call the handler function
-                _monitoredFds.at(fd).getHandler(events & evt)(fd);
-            }
-        }
+template<typename Traits>
+bool BasicEpoll<Traits>::runOnce() {
+    if (!_keepRunning())
+        return false;
 
-        // Remove this descriptor if it's closing (this will work only if EPOLLRDHUP or EPOLLHUP events are listened for)
-        if (events & (EPOLLRDHUP | EPOLLHUP)) {
-            removeDescriptor(fd);
-        }
+    _waitForEvents(Clock::time_point::max());
+    return true;
+}
+
+template<typename Traits>
+void BasicEpoll<Traits>::runFor(std::chrono::nanoseconds duration) {
+    const Clock::time_point deadline = _getDeadline(duration);
+    while (Clock::now() < deadline && _keepRunning()) {
+        _waitForEvents(deadline);
     }
 }
 
-void Epoll::addEventHandler(int monitoredFd, uint32_t eventType, std::function<void(int)> eventHandler) {
-    if (_monitoredFds.count(monitoredFd) == 0) {
-        throw std::runtime_error("Epoll::addEventHandler: ERROR - file descriptor must first be added to Epoll before adding event handler.");
+template<typename Traits>
+void BasicEpoll<Traits>::stop() {
+    _isStopRequested.store(true, std::memory_order_release);
+
+    // The loop thread checks the flag after the current pass anyway, another thread has to interrupt the wait
+    if (_isForeignThread()) {
+        _wakeUp();
     }
+}
 
-    MonitoredDescriptor &md = _monitoredFds.at(monitoredFd);
+template<typename Traits>
+void BasicEpoll<Traits>::post(std::function<void()> task) {
+    _post(std::move(task));
+}
 
-    // Check for all possible event types
-    for (uint32_t evt: allEventTypes) {
-        if (eventType & evt) {
-            // Set the handler, if eventType includes this evt
-            md.setHandler(evt, eventHandler);
-        }
+template<typename Traits>
+typename BasicEpoll<Traits>::TimerId BasicEpoll<Traits>::addTimer(std::chrono::nanoseconds duration, std::function<void()> callback, bool repeat) {
+    if (repeat && duration <= std::chrono::nanoseconds::zero()) {
+        throw std::runtime_error("Epoll::addTimer: ERROR - A repeating timer needs a positive duration.");
+    }
+
+    const TimerId id = _nextTimerId.fetch_add(1, std::memory_order_relaxed);
+    const TimerQueue::Clock::time_point deadline = TimerQueue::Clock::now() + duration;
+    const TimerQueue::Clock::duration interval = repeat ? duration : TimerQueue::Clock::duration::zero();
+
+    if (_isForeignThread()) {
+        // The posted task wakes up the loop, which then computes its timeout with the new timer included
+        _post([this, id, deadline, interval, callback = std::move(callback)]() mutable {
+            _timers.add(id, deadline, interval, std::move(callback));
+        });
+        return id;
+    }
+
+    _timers.add(id, deadline, interval, std::move(callback));
+    return id;
+}
+
+template<typename Traits>
+void BasicEpoll<Traits>::cancelTimer(TimerId id) {
+    if (_isForeignThread()) {
+        _post([this, id] { cancelTimer(id); });
+        return;
+    }
+
+    _timers.cancel(id);
+}
+
+template<typename Traits>
+typename BasicEpoll<Traits>::TimeoutId BasicEpoll<Traits>::addTimeout(std::chrono::milliseconds timeout, TimeoutHandler handler) {
+    _checkLoopThread("addTimeout");
+    return _timeouts.add(timeout, std::move(handler));
+}
+
+template<typename Traits>
+bool BasicEpoll<Traits>::resetTimeout(TimeoutId id, std::chrono::milliseconds timeout) {
+    _checkLoopThread("resetTimeout");
+    return _timeouts.reset(id, timeout);
+}
+
+template<typename Traits>
+bool BasicEpoll<Traits>::cancelTimeout(TimeoutId id) {
+    _checkLoopThread("cancelTimeout");
+    return _timeouts.cancel(id);
+}
+
+template<typename Traits>
+void BasicEpoll<Traits>::addSignalHandler(int signo, std::function<void(int)> callback) {
+    _checkLoopThread("addSignalHandler");
+
+    if (signo == SIGKILL || signo == SIGSTOP || sigismember(&_handledSignals, signo) == -1) {
+        throw std::runtime_error("Epoll::addSignalHandler: ERROR - Signal " + std::to_string(signo) + " can't be handled.");
+    }
+
+    sigset_t signalSet;
+    sigemptyset(&signalSet);
+    sigaddset(&signalSet, signo);
+
+    // A signal which the caller blocked on its own stays blocked after removeSignalHandler()
+    sigset_t previousMask;
+    if (pthread_sigmask(SIG_BLOCK, &signalSet, &previousMask) != 0) {
+        throw std::runtime_error("Epoll::addSignalHandler: ERROR - Failed to block signal " + std::to_string(signo) + ".");
+    }
+    if (!sigismember(&previousMask, signo)) {
+        sigaddset(&_blockedSignals, signo);
+    }
+
+    _signalHandlers[signo] = std::move(callback);
+    if (!sigismember(&_handledSignals, signo)) {
+        sigaddset(&_handledSignals, signo);
+        _updateSignalFd();
+    }
+}
+
+template<typename Traits>
+void BasicEpoll<Traits>::removeSignalHandler(int signo) {
+    _checkLoopThread("removeSignalHandler");
+
+    if (_signalHandlers.erase(signo) == 0)
+        return;
+
+    sigdelset(&_handledSignals, signo);
+    _updateSignalFd();
+
+    if (sigismember(&_blockedSignals, signo)) {
+        sigdelset(&_blockedSignals, signo);
+
+        sigset_t signalSet;
+        sigemptyset(&signalSet);
+        sigaddset(&signalSet, signo);
+        pthread_sigmask(SIG_UNBLOCK, &signalSet, nullptr);
+    }
+}
+
+template<typename Traits>
+void BasicEpoll<Traits>::addEventHandler(int monitoredFd, uint32_t eventType, EventHandler eventHandler) {
+    if (_isForeignThread()) {
+        _post([this, monitoredFd, eventType, eventHandler = std::move(eventHandler)]() mutable {
+            addEventHandler(monitoredFd, eventType, std::move(eventHandler));
+        });
+        return;
+    }
+
+    MonitoredDescriptor *mdPtr = _monitoredFds.find(monitoredFd);
+    if (mdPtr == nullptr) {
+        throw std::runtime_error("Epoll::addEventHandler: ERROR - file descriptor must first be added to Epoll before adding event handler.");
     }
 
+    MonitoredDescriptor &md = *mdPtr;
+    _checkExclusiveEvents(md, eventType);
+
+    // The handler is stored once and shared by all event types included in eventType
+    md.setHandler(eventType, std::move(eventHandler));
+
     // After all handlers are set, register the events for listening with the OS kernel
     _reloadEventHandlers(md);
 }
 
-void Epoll::removeEventHandler(int monitoredFd, uint32_t eventType) {
+template<typename Traits>
+void BasicEpoll<Traits>::addEventHandler(int monitoredFd, uint32_t eventType, void (*eventHandler)(int, void *), void *context) {
+    // Other handler types than InplaceFunction have no constructor for a function with its context
+    if constexpr (std::is_constructible_v<EventHandler, void (*)(int, void *), void *>) {
+        addEventHandler(monitoredFd, eventType, EventHandler(eventHandler, context));
+    } else {
+        addEventHandler(monitoredFd, eventType, EventHandler([eventHandler, context](int fd) { eventHandler(fd, context); }));
+    }
+}
+
+template<typename Traits>
+void BasicEpoll<Traits>::addEventHandler(int monitoredFd, uint32_t eventType, CombinedEventHandler eventHandler) {
+    if (_isForeignThread()) {
+        _post([this, monitoredFd, eventType, eventHandler = std::move(eventHandler)]() mutable {
+            addEventHandler(monitoredFd, eventType, std::move(eventHandler));
+        });
+        return;
+    }
+
+    MonitoredDescriptor *md = _monitoredFds.find(monitoredFd);
+    if (md == nullptr) {
+        throw std::runtime_error("Epoll::addEventHandler: ERROR - file descriptor must first be added to Epoll before adding event handler.");
+    }
+
+    _checkExclusiveEvents(*md, eventType);
+    md->setCombinedHandler(eventType, std::move(eventHandler));
+
+    // Register the events for listening with the OS kernel
+    _reloadEventHandlers(*md);
+}
+
+template<typename Traits>
+void BasicEpoll<Traits>::removeEventHandler(int monitoredFd, uint32_t eventType) {
+    if (_isForeignThread()) {
+        _post([this, monitoredFd, eventType] { removeEventHandler(monitoredFd, eventType); });
+        return;
+    }
+
     auto &md = _monitoredFds.at(monitoredFd);
 
-    // Check for all possible event types
-    for (uint32_t evt: allEventTypes) {
-        // Check if the handler for this event exists
-        if (md.hasHandler(eventType & evt)) {
-            // remove the handler function
-            md.setHandler(eventType & evt, nullptr);
-        }
+    // Remove the handler function of every event type included in eventType
+    md.setHandler(eventType, nullptr);
+
+    // The combined handler stays only while it has some event type left
+    if (md.getCombinedHandlerMask() & eventType) {
+        md.setCombinedHandler(md.getCombinedHandlerMask() & ~eventType, std::move(md.getCombinedHandler()));
     }
 
     // Make sure that removed events aren't listened for by the OS kernel
     _reloadEventHandlers(md);
 }
 
+template<typename Traits>
+void BasicEpoll<Traits>::asyncRead(int fd, void *buffer, size_t size, AsyncIoHandler handler) {
+    _checkLoopThread("asyncRead");
+
+    MonitoredDescriptor *md = _monitoredFds.find(fd);
+    if (md == nullptr) {
+        throw std::runtime_error("Epoll::asyncRead: ERROR - file descriptor must first be added to Epoll before reading from it.");
+    }
+    if (size == 0 || handler == nullptr) {
+        throw std::runtime_error("Epoll::asyncRead: ERROR - The buffer must not be empty and the handler must not be null.");
+    }
+
+    AsyncIoState &io = _getAsyncIo(*md);
+    if (io.read.handler != nullptr) {
+        throw std::runtime_error("Epoll::asyncRead: ERROR - A read of FD" + std::to_string(fd) + " is already pending.");
+    }
+
+    const uint32_t previousInterest = _getAsyncInterest(*md);
+    io.read = AsyncIoState::Read{static_cast<char *>(buffer), size, std::move(handler)};
+    _startAsyncIo(*md, previousInterest, io.isReadable);
+}
+
+template<typename Traits>
+void BasicEpoll<Traits>::asyncWrite(int fd, const void *data, size_t size, AsyncIoHandler handler) {
+    _checkLoopThread("asyncWrite");
+
+    MonitoredDescriptor *md = _monitoredFds.find(fd);
+    if (md == nullptr) {
+        throw std::runtime_error("Epoll::asyncWrite: ERROR - file descriptor must first be added to Epoll before writing to it.");
+    }
+    if (size == 0 || handler == nullptr) {
+        throw std::runtime_error("Epoll::asyncWrite: ERROR - The data must not be empty and the handler must not be null.");
+    }
+
+    AsyncIoState &io = _getAsyncIo(*md);
+    if (io.write.handler != nullptr) {
+        throw std::runtime_error("Epoll::asyncWrite: ERROR - A write of FD" + std::to_string(fd) + " is already pending.");
+    }
+
+    const uint32_t previousInterest = _getAsyncInterest(*md);
+    io.write = AsyncIoState::Write{static_cast<const char *>(data), size, 0, std::move(handler)};
+    _startAsyncIo(*md, previousInterest, io.isWritable);
+}
+
+template<typename Traits>
+typename BasicEpoll<Traits>::Connection &BasicEpoll<Traits>::addConnection(int fd, ConnectionDataHandler onData, ConnectionCloseHandler onClose) {
+    _checkLoopThread("addConnection");
+
+    if (onData == nullptr) {
+        throw std::runtime_error("Epoll::addConnection: ERROR - The data handler must not be null.");
+    }
+    if (_findConnection(fd) != nullptr) {
+        throw std::runtime_error("Epoll::addConnection: ERROR - FD" + std::to_string(fd) + " already is a connection.");
+    }
+
+    addDescriptor(fd);
+    MonitoredDescriptor &md = *_monitoredFds.find(fd);
+    md.connection = makeSlabPtr<Connection>(_connectionPool, *this, fd, std::move(onData), std::move(onClose));
+
+    Connection &connection = *md.connection;
+    connection._awaitReadable();
+    return connection;
+}
+
+#ifdef EPOLL_CPP_COROUTINES
+// # Coroutine awaiters
+// ######################################################################################################################
+
+template<typename Traits>
+void BasicReadinessAwaiter<Traits>::await_suspend(std::coroutine_handle<> handle) {
+    // The handle is the context pointer, the coroutine is resumed without any intermediate callable
+    _epoll._awaitReadiness(_fd, _eventType, AsyncIoHandler([](int, ssize_t, void *address) {
+        EpollTask::resume(std::coroutine_handle<>::from_address(address));
+    }, handle.address()));
+}
+
+template<typename Traits>
+void BasicSleepAwaiter<Traits>::await_suspend(std::coroutine_handle<> handle) {
+    _epoll.addTimeout(_duration, [handle] { EpollTask::resume(handle); });
+}
+
+#endif
 // # Epoll class getters
 // ######################################################################################################################
 
-const std::unordered_map<int, MonitoredDescriptor> &Epoll::getMonitoredFds() const {
+template<typename Traits>
+const typename BasicEpoll<Traits>::DescriptorTable &BasicEpoll<Traits>::getMonitoredFds() const {
     return _monitoredFds;
 }
 
-int Epoll::getEpollFd() const {
+template<typename Traits>
+int BasicEpoll<Traits>::getEpollFd() const {
     return _epollFd;
 }
 
-int Epoll::isEdgeTriggered() const {
-    return _isEdgeTriggered;
+template<typename Traits>
+EpollBackend BasicEpoll<Traits>::getBackend() const {
+    return _backend;
 }
 
 // # Epoll class private members
 // ######################################################################################################################
 
-void Epoll::_reloadEventHandlers(MonitoredDescriptor &md) const {
-    uint32_t resultingEvents = 0;
-
-    // Construct a resultingEvents variable for all registered event handlers of monitoredDescriptor
-    bool firstEvt = true;
-    for (uint32_t evt: allEventTypes) {
-        if (md.hasHandler(evt)) {
-            if (firstEvt) {
-                resultingEvents = evt;
-                firstEvt = false;
-            } else {
-                resultingEvents |= evt;
+template<typename Traits>
+void BasicEpoll<Traits>::_awaitReadiness(int fd, uint32_t eventType, AsyncIoHandler handler) {
+    _checkLoopThread(eventType == EPOLLIN ? "readable" : "writable");
+
+    MonitoredDescriptor *md = _monitoredFds.find(fd);
+    if (md == nullptr) {
+        throw std::runtime_error("Epoll::_awaitReadiness: ERROR - file descriptor must first be added to Epoll before awaiting it.");
+    }
+
+    AsyncIoState &io = _getAsyncIo(*md);
+    const uint32_t previousInterest = _getAsyncInterest(*md);
+
+    if (eventType == EPOLLIN) {
+        if (io.read.handler != nullptr) {
+            throw std::runtime_error("Epoll::_awaitReadiness: ERROR - A read of FD" + std::to_string(fd) + " is already pending.");
+        }
+        io.read = AsyncIoState::Read{nullptr, 0, std::move(handler)};
+        _startAsyncIo(*md, previousInterest, io.isReadable);
+    } else {
+        if (io.write.handler != nullptr) {
+            throw std::runtime_error("Epoll::_awaitReadiness: ERROR - A write of FD" + std::to_string(fd) + " is already pending.");
+        }
+        io.write = AsyncIoState::Write{nullptr, 0, 0, std::move(handler)};
+        _startAsyncIo(*md, previousInterest, io.isWritable);
+    }
+}
+
+template<typename Traits>
+typename BasicEpoll<Traits>::Connection *BasicEpoll<Traits>::_findConnection(int fd) {
+    MonitoredDescriptor *md = _monitoredFds.find(fd);
+    return md != nullptr ? md->connection.get() : nullptr;
+}
+
+template<typename Traits>
+void BasicEpoll<Traits>::_waitForEvents(Clock::time_point deadline) {
+    // From now on, registration changes made by other threads are deferred to this thread
+    const std::thread::id currentThreadId = std::this_thread::get_id();
+    if (_loopThreadId.load(std::memory_order_relaxed) != currentThreadId) {
+        _loopThreadId.store(currentThreadId, std::memory_order_release);
+    }
+
+    // Start waiting for descriptor events, at most until the caller's deadline or the next timer or timeout of the loop.
+    // Async operations which can already run don't let the loop block.
+    if (!_readyAsyncFds.empty()) {
+        deadline = Clock::now();
+    }
+    int numOfEvents = _epollWait(std::min(deadline, _getNextDeadline()));
+    // Only the size of the next batch changes, events of this batch stay where they are
+    _adaptBatchSize(numOfEvents);
+
+    // Before any handler runs, stamp untagged events with the generation of their record. Handlers can remove descriptors and
+    // new descriptors can get the same fd numbers, the events of this batch must still reach only the records they belong to.
+    for (int i = 0; i < numOfEvents; i++) {
+        const uint64_t token = _eventsVector[i].data.u64;
+        if (DescriptorTable::getTokenGeneration(token) == 0) {
+            const int fd = DescriptorTable::getTokenFd(token);
+            _eventsVector[i].data.u64 = DescriptorTable::makeEventToken(fd, _monitoredFds.getGeneration(fd));
+        }
+    }
+
+    _isDispatching = true;
+    try {
+        // Before the descriptor handlers, so that timeouts they add or reset are counted from the current time
+        const Clock::time_point now = Clock::now();
+        _timers.runExpired(now);
+        _timeouts.advance(now);
+
+        for (int i = 0; i < numOfEvents; i++) {
+            _dispatchEvent(_eventsVector[i]);
+        }
+
+        _runReadyAsyncIo();
+    } catch (...) {
+        _finishBatch();
+        throw;
+    }
+    _finishBatch();
+}
+
+template<typename Traits>
+bool BasicEpoll<Traits>::_keepRunning() {
+    // The request is consumed, so the loop can be run again later
+    if (_isStopRequested.exchange(false, std::memory_order_acq_rel))
+        return false;
+
+    // A pending wakeup can bring posted tasks, for example a deferred addDescriptor()
+    return !_monitoredFds.empty() || !_timers.empty() || !_timeouts.empty() || _isWakeupPending.load(std::memory_order_acquire);
+}
+
+template<typename Traits>
+typename BasicEpoll<Traits>::Clock::time_point BasicEpoll<Traits>::_getDeadline(std::chrono::nanoseconds timeout) {
+    const Clock::time_point now = Clock::now();
+    // Durations which would overflow the time point (nanoseconds::max() for example) never end
+    if (timeout >= Clock::time_point::max() - now)
+        return Clock::time_point::max();
+
+    return now + std::max(timeout, std::chrono::nanoseconds::zero());
+}
+
+template<typename Traits>
+void BasicEpoll<Traits>::_dispatchEvent(const epoll_event &event) {
+    const uint32_t events = event.events;
+    const int fd = DescriptorTable::getTokenFd(event.data.u64);
+    const uint32_t generation = DescriptorTable::getTokenGeneration(event.data.u64);
+
+    if (generation == DescriptorTable::INTERNAL_GENERATION) {
+        _dispatchInternalEvent(fd);
+        return;
+    }
+
+    // The record was removed after the kernel queued the event, or earlier in this batch (its fd may be already reused)
+    MonitoredDescriptor *md = _monitoredFds.find(fd, generation);
+    if (md == nullptr)
+        return;
+
+    // Async operations go first, they have to see every readiness change of the fd
+    if (md->asyncIo != nullptr) {
+        _runAsyncIo(fd, generation, events);
+
+        md = _monitoredFds.find(fd, generation);
+        if (md == nullptr)
+            return;
+    }
+
+    // The combined handler gets all events of this fd at once
+    if (events & md->getCombinedHandlerMask()) {
+        md->getCombinedHandler()(fd, events);
+
+        md = _monitoredFds.find(fd, generation);
+        if (md == nullptr)
+            return;
+    }
+
+    // Walk only the event types which occurred and have a handler, lowest bit first
+    uint32_t pendingEvents = events & md->getHandlerMask();
+    while (pendingEvents != 0) {
+        const uint32_t evt = 1u << __builtin_ctz(pendingEvents);
+        pendingEvents &= pendingEvents - 1;
+
+        // Call the handler function, evt comes from the handler mask so the checks of getHandler() aren't needed
+        md->getHandlerUnchecked(evt)(fd);
+
+        // The monitored descriptor can be removed (or removed and added again) during the event handling process, protect against this.
+        // Records never move and the generation changes on every removal, so an unchanged generation means md is still valid.
+        if (_monitoredFds.getGeneration(fd) != generation)
+            return;
+
+        // The handler could have removed some of the remaining handlers
+        pendingEvents &= md->getHandlerMask();
+    }
+
+    // Remove this descriptor if it's closing (this will work only if EPOLLRDHUP or EPOLLHUP events are listened for)
+    if (events & (EPOLLRDHUP | EPOLLHUP)) {
+        removeDescriptor(fd);
+    }
+}
+
+template<typename Traits>
+void BasicEpoll<Traits>::_runAsyncIo(int fd, uint32_t generation, uint32_t events) {
+    MonitoredDescriptor *md = _monitoredFds.find(fd, generation);
+    AsyncIoState *io = md->asyncIo.get();
+    const uint32_t previousInterest = _getAsyncInterest(*md);
+
+    if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+        io->isReadable = true;
+    }
+    if (events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) {
+        io->isWritable = true;
+    }
+
+    io->isRunning = true;
+    try {
+        ssize_t result = 0;
+        if (io->read.handler != nullptr && io->isReadable && _performAsyncRead(fd, *io, result)) {
+            // The handler can start the next read right away
+            AsyncIoHandler handler = std::move(io->read.handler);
+            io->read = AsyncIoState::Read{};
+            handler(fd, result);
+
+            // The handler could have removed the descriptor
+            md = _monitoredFds.find(fd, generation);
+            if (md == nullptr)
+                return;
+        }
+
+        if (io->write.handler != nullptr && io->isWritable && _performAsyncWrite(fd, *io, result)) {
+            AsyncIoHandler handler = std::move(io->write.handler);
+            io->write = AsyncIoState::Write{};
+            handler(fd, result);
+
+            md = _monitoredFds.find(fd, generation);
+            if (md == nullptr)
+                return;
+        }
+    } catch (...) {
+        io->isRunning = false;
+        throw;
+    }
+    io->isRunning = false;
+
+    // In level triggered mode the kernel watches only the directions with a pending operation
+    if (_getAsyncInterest(*md) != previousInterest) {
+        _reloadEventHandlers(*md);
+    }
+}
+
+template<typename Traits>
+void BasicEpoll<Traits>::_runReadyAsyncIo() {
+    // Operations started by the handlers below are queued again and run during the next (non-blocking) pass
+    _runningAsyncFds.swap(_readyAsyncFds);
+
+    size_t i = 0;
+    try {
+        for (; i < _runningAsyncFds.size(); i++) {
+            const auto [fd, generation] = _runningAsyncFds[i];
+            MonitoredDescriptor *md = _monitoredFds.find(fd, generation);
+            if (md == nullptr || md->asyncIo == nullptr)
+                continue;
+
+            md->asyncIo->isQueued = false;
+            _runAsyncIo(fd, generation, 0);
+        }
+    } catch (...) {
+        // The descriptors after the failed one are still marked as queued
+        _readyAsyncFds.insert(_readyAsyncFds.end(), _runningAsyncFds.begin() + i + 1, _runningAsyncFds.end());
+        _runningAsyncFds.clear();
+        throw;
+    }
+    _runningAsyncFds.clear();
+}
+
+template<typename Traits>
+void BasicEpoll<Traits>::_startAsyncIo(MonitoredDescriptor &md, uint32_t previousInterest, bool isReady) {
+    AsyncIoState &io = *md.asyncIo;
+
+    // Level triggered mode makes the syscall only after the kernel reports the readiness
+    if (isEdgeTriggered() && isReady && !io.isQueued) {
+        io.isQueued = true;
+        _readyAsyncFds.emplace_back(md.monitoredFd, _monitoredFds.getGeneration(md.monitoredFd));
+    }
+
+    if (!io.isRunning && _getAsyncInterest(md) != previousInterest) {
+        _reloadEventHandlers(md);
+    }
+}
+
+template<typename Traits>
+AsyncIoState &BasicEpoll<Traits>::_getAsyncIo(MonitoredDescriptor &md) {
+    if (md.asyncIo == nullptr) {
+        // Sockets are used with MSG_DONTWAIT. Other descriptors (pipes, FIFOs, ttys) have no such flag, a read or write made after
+        // a stale readiness (or a partial write) would block the loop, so they are switched to O_NONBLOCK.
+        struct stat status{};
+        const bool isSocket = fstat(md.monitoredFd, &status) == 0 && S_ISSOCK(status.st_mode);
+        if (!isSocket) {
+            const int flags = fcntl(md.monitoredFd, F_GETFL);
+            if (flags == -1 || ((flags & O_NONBLOCK) == 0 && fcntl(md.monitoredFd, F_SETFL, flags | O_NONBLOCK) == -1)) {
+                throw std::runtime_error("Epoll::_getAsyncIo: ERROR - Failed to make FD" + std::to_string(md.monitoredFd) + " non-blocking.");
             }
         }
+
+        md.asyncIo = makeSlabPtr<AsyncIoState>(_asyncIoPool);
+        md.asyncIo->isSocket = isSocket;
+
+        // Registering the interest again makes the kernel report the current readiness, even the edges which already came
+        if (isEdgeTriggered()) {
+            _reloadEventHandlers(md);
+        }
+    }
+    return *md.asyncIo;
+}
+
+template<typename Traits>
+uint32_t BasicEpoll<Traits>::_getAsyncInterest(const MonitoredDescriptor &md) const {
+    if (md.asyncIo == nullptr)
+        return 0;
+
+    if (isEdgeTriggered())
+        return EPOLLIN | EPOLLOUT;
+
+    return (md.asyncIo->read.handler != nullptr ? uint32_t(EPOLLIN) : 0u) | (md.asyncIo->write.handler != nullptr ? uint32_t(EPOLLOUT) : 0u);
+}
+
+template<typename Traits>
+bool BasicEpoll<Traits>::_performAsyncRead(int fd, AsyncIoState &io, ssize_t &result) const {
+    AsyncIoState::Read &read = io.read;
+
+    // Readiness only, the caller reads by itself (until EAGAIN in edge triggered mode)
+    if (read.size == 0) {
+        io.isReadable = false;
+        result = 0;
+        return true;
+    }
+
+    size_t total = 0;
+    ssize_t status;
+
+    for (;;) {
+        // MSG_DONTWAIT, sockets of a level triggered Epoll can be blocking. Other descriptors were made non-blocking.
+        status = io.isSocket ? recv(fd, read.buffer + total, read.size - total, MSG_DONTWAIT) : ::read(fd, read.buffer + total, read.size - total);
+
+        if (status > 0) {
+            total += status;
+            // In level triggered mode the kernel reports the rest of the data again
+            if (total == read.size || !isEdgeTriggered())
+                break;
+            continue;
+        }
+
+        if (status == -1 && errno == EINTR)
+            continue;
+        if (status == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            io.isReadable = false;
+        }
+        break;
+    }
+
+    if (!isEdgeTriggered()) {
+        io.isReadable = false;
+    }
+
+    // The end of file or an error which came after some data is reported by the next read, the fd stays readable
+    if (total > 0) {
+        result = ssize_t(total);
+    } else if (status == 0) {
+        result = 0;
+    } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        result = -errno;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+template<typename Traits>
+bool BasicEpoll<Traits>::_performAsyncWrite(int fd, AsyncIoState &io, ssize_t &result) const {
+    AsyncIoState::Write &write = io.write;
+
+    if (write.size == 0) {
+        io.isWritable = false;
+        result = 0;
+        return true;
+    }
+
+
+    for (;;) {
+        const char *data = write.data + write.written;
+        const size_t size = write.size - write.written;
+        const ssize_t status = io.isSocket ? send(fd, data, size, MSG_DONTWAIT | MSG_NOSIGNAL) : ::write(fd, data, size);
+
+        if (status >= 0) {
+            write.written += status;
+            if (write.written == write.size) {
+                result = ssize_t(write.written);
+                return true;
+            }
+            // In level triggered mode the rest is written once the kernel reports EPOLLOUT again
+            if (!isEdgeTriggered()) {
+                io.isWritable = false;
+                return false;
+            }
+            continue;
+        }
+
+        if (errno == EINTR)
+            continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            io.isWritable = false;
+            return false;
+        }
+
+        result = -errno;
+        return true;
+    }
+}
+
+template<typename Traits>
+void BasicEpoll<Traits>::_finishBatch() {
+    _isDispatching = false;
+    _retiredDescriptors.clear();
+
+    // The loop may not wait again for a long time (or ever), the removed fds must not stay referenced by their poll requests
+    if (_ioUring != nullptr) {
+        _ioUring->submitRemovals();
+    }
+}
+
+template<typename Traits>
+void BasicEpoll<Traits>::_dispatchInternalEvent(int fd) {
+    if (fd == _wakeupFd) {
+        _runPostedTasks();
+    } else if (fd == _signalFd) {
+        _runSignalHandlers();
+    }
+}
+
+template<typename Traits>
+void BasicEpoll<Traits>::_runPostedTasks() {
+    eventfd_t value;
+    eventfd_read(_wakeupFd, &value);
+
+    // Clear the flag before draining: a task pushed after this point signals the eventfd again,
+    // a task pushed before it is already linked into the queue
+    _isWakeupPending.exchange(false, std::memory_order_acq_rel);
+
+    PostedTask task;
+    int tasksNum = 0;
+    try {
+        while (_postedTasks.tryPop(task)) {
+            task();
+            task = nullptr;
+
+            if (++tasksNum == MAX_POSTED_TASKS_NUM) {
+                // The rest will run during the next pass
+                _wakeUp();
+                return;
+            }
+        }
+    } catch (...) {
+        // Don't leave the remaining tasks waiting for another post
+        _wakeUp();
+        throw;
+    }
+}
+
+template<typename Traits>
+void BasicEpoll<Traits>::_runSignalHandlers() {
+    // The signalfd is level triggered, signals left unread by a throwing handler are handled during the next pass
+    struct signalfd_siginfo info{};
+    while (read(_signalFd, &info, sizeof(info)) == sizeof(info)) {
+        const int signo = int(info.ssi_signo);
+
+        auto it = _signalHandlers.find(signo);
+        if (it == _signalHandlers.end())
+            continue;
+
+        // The handler may remove itself, which would destroy it in the middle of the call
+        std::function<void(int)> callback = it->second;
+        callback(signo);
+    }
+}
+
+template<typename Traits>
+void BasicEpoll<Traits>::_updateSignalFd() {
+    const bool isNew = _signalFd == -1;
+
+    const int fd = signalfd(_signalFd, &_handledSignals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (fd == -1) {
+        throw std::runtime_error("Epoll::_updateSignalFd: ERROR - Failed to update signalfd.");
+    }
+
+    if (isNew) {
+        try {
+            _epollCtlAdd(fd, EPOLLIN, DescriptorTable::makeEventToken(fd, DescriptorTable::INTERNAL_GENERATION));
+        } catch (...) {
+            close(fd);
+            throw;
+        }
+        _signalFd = fd;
+    }
+}
+
+template<typename Traits>
+typename BasicEpoll<Traits>::Clock::time_point BasicEpoll<Traits>::_getNextDeadline() {
+    return std::min(_timers.getNextDeadline(), _timeouts.getNextDeadline());
+}
+
+template<typename Traits>
+int BasicEpoll<Traits>::_epollWait(Clock::time_point deadline) {
+    const int batchSize = getBatchSize();
+    if (_ioUring != nullptr)
+        return _ioUring->wait(_eventsVector.data(), batchSize, deadline);
+
+    const bool isInfinite = deadline == Clock::time_point::max();
+    const Clock::duration remaining = isInfinite ? Clock::duration::zero() : std::max(deadline - Clock::now(), Clock::duration::zero());
+
+#ifdef SYS_epoll_pwait2
+    if (_isPwait2Supported) {
+        const auto remainingNs = std::chrono::duration_cast<std::chrono::nanoseconds>(remaining).count();
+        struct timespec spec{};
+        spec.tv_sec = remainingNs / 1000000000;
+        spec.tv_nsec = remainingNs % 1000000000;
+
+        // No glibc wrapper is needed, the kernel ignores the sigset size when no sigmask is passed
+        const int result = int(syscall(SYS_epoll_pwait2, _epollFd, _eventsVector.data(), batchSize, isInfinite ? nullptr : &spec, nullptr, 0));
+        if (result != -1 || (errno != ENOSYS && errno != EPERM))
+            return result;
+
+        // Kernels older than 5.11, or a seccomp profile which doesn't know the syscall yet (Docker's default one returned EPERM
+        // before 20.10.10). Stay with epoll_wait() from now on.
+        _isPwait2Supported = false;
+    }
+#endif
+
+    int timeout = -1;
+    if (!isInfinite) {
+        // Round up, waking up before the deadline would only cost another epoll_wait() call
+        const auto remainingMs = std::chrono::ceil<std::chrono::milliseconds>(remaining).count();
+        timeout = int(std::min<decltype(remainingMs)>(remainingMs, INT32_MAX));
+    }
+    return epoll_wait(_epollFd, _eventsVector.data(), batchSize, timeout);
+}
+
+template<typename Traits>
+void BasicEpoll<Traits>::_checkLoopThread(const char *method) const {
+    if (_isForeignThread()) {
+        throw std::runtime_error(std::string("Epoll::") + method + ": ERROR - Must be called on the thread which runs waitForEvents().");
+    }
+}
+
+template<typename Traits>
+void BasicEpoll<Traits>::_post(PostedTask task) {
+    _postedTasks.push(std::move(task));
+    _wakeUp();
+}
+
+template<typename Traits>
+void BasicEpoll<Traits>::_wakeUp() {
+    if (!_isWakeupPending.exchange(true, std::memory_order_acq_rel)) {
+        if (eventfd_write(_wakeupFd, 1) == -1) {
+            throw std::runtime_error("Epoll::_wakeUp: ERROR - Failed to signal wakeup eventfd.");
+        }
+    }
+}
+
+template<typename Traits>
+void BasicEpoll<Traits>::_adaptBatchSize(int numOfEvents) {
+    // A batch size fixed by the traits never changes
+    if constexpr (Traits::batchSize != 0)
+        return;
+
+    // Timeouts and errors say nothing about the load
+    if (numOfEvents <= 0)
+        return;
+
+    if (numOfEvents == _batchSize) {
+        _sparseBatchesNum = 0;
+        if (++_fullBatchesNum >= BATCH_ADAPT_WINDOW && _batchSize < _maxBatchSize) {
+            _batchSize = std::min(_batchSize * 2, _maxBatchSize);
+            _eventsVector.resize(_batchSize);
+            _fullBatchesNum = 0;
+        }
+    } else if (numOfEvents < _batchSize / 4) {
+        _fullBatchesNum = 0;
+        if (++_sparseBatchesNum >= BATCH_ADAPT_WINDOW && _batchSize > _minBatchSize) {
+            // The buffer keeps its size, growing back later won't reallocate
+            _batchSize = std::max(_batchSize / 2, _minBatchSize);
+            _sparseBatchesNum = 0;
+        }
+    } else {
+        _fullBatchesNum = 0;
+        _sparseBatchesNum = 0;
     }
+}
+
+template<typename Traits>
+void BasicEpoll<Traits>::_reloadEventHandlers(MonitoredDescriptor &md) const {
+    // Listen for all event types which have a registered event handler, and for the readiness the async operations need
+    const uint32_t resultingEvents = md.getInterestMask() | _getAsyncInterest(md) | _getTriggerModeEvents();
+
+    const uint64_t token = DescriptorTable::makeEventToken(md.monitoredFd, md.isTagged ? _monitoredFds.getGeneration(md.monitoredFd) : 0);
 
-    if (_isEdgeTriggered) {
-        if (firstEvt)
-            resultingEvents = EPOLLET;
-        else
-            resultingEvents |= EPOLLET;
+    if (md.isExclusive) {
+        // The kernel rejects EPOLL_CTL_MOD of an exclusive fd, changed events require deleting and adding the fd again
+        if (md.isInitialized) {
+            _epollCtlDelete(md.monitoredFd);
+        }
+        _epollCtlAdd(md.monitoredFd, resultingEvents | EPOLLEXCLUSIVE, token);
+        md.isInitialized = true;
+        return;
     }
 
     //"EPOLL_CTL_ADD" can be called for a single FD only once
     if (md.isInitialized) {
-        _epollCtlModify(md.monitoredFd, resultingEvents);
+        _epollCtlModify(md.monitoredFd, resultingEvents, token);
     } else {
-        _epollCtlAdd(md.monitoredFd, resultingEvents);
+        _epollCtlAdd(md.monitoredFd, resultingEvents, token);
         md.isInitialized = true;
     }
 }
 
-void Epoll::_epollCtlAdd(int fd, uint32_t events) const {
+template<typename Traits>
+void BasicEpoll<Traits>::_epollCtlAdd(int fd, uint32_t events, uint64_t token) const {
+    if (_ioUring != nullptr) {
+        _ioUring->add(fd, events, token);
+        return;
+    }
+
     struct epoll_event ev{};
     ev.events = events;
-    ev.data.fd = fd;
+    ev.data.u64 = token;
     if (epoll_ctl(_epollFd, EPOLL_CTL_ADD, fd, &ev) == -1) {
         throw std::runtime_error("Epoll::_epollCtlAdd: ERROR - Failed adding event to descriptor.");
     }
 }
 
-void Epoll::_epollCtlModify(int fd, uint32_t events) const {
+template<typename Traits>
+void BasicEpoll<Traits>::_epollCtlModify(int fd, uint32_t events, uint64_t token) const {
+    if (_ioUring != nullptr) {
+        _ioUring->modify(fd, events, token);
+        return;
+    }
+
     struct epoll_event ev{};
     ev.events = events;
-    ev.data.fd = fd;
+    ev.data.u64 = token;
     if (epoll_ctl(_epollFd, EPOLL_CTL_MOD, fd, &ev) == -1) {
         throw std::runtime_error("Epoll::_epollCtlModify: ERROR - Failed modifying file descriptor events.");
     }
 }
 
-void Epoll::_setNonBlocking(int fd) {
+template<typename Traits>
+void BasicEpoll<Traits>::_setNonBlocking(int fd) {
     if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK) == -1) {
         throw std::runtime_error("Epoll::_setNonBlocking: ERROR - Failed to set descriptor into non-blocking mode.");
     }
 }
 
-void Epoll::_epollCtlDelete(int fd) const {
+template<typename Traits>
+void BasicEpoll<Traits>::_checkExclusiveEvents(const MonitoredDescriptor &md, uint32_t eventTypes) {
+    if (md.isExclusive && (eventTypes & allEventTypesMask & ~exclusiveEventTypesMask) != 0) {
+        throw std::runtime_error("Epoll::_checkExclusiveEvents: ERROR - EPOLLEXCLUSIVE descriptors can only handle EPOLLIN, EPOLLOUT, EPOLLERR and EPOLLHUP.");
+    }
+}
+
+template<typename Traits>
+void BasicEpoll<Traits>::_epollCtlDelete(int fd) const {
+    if (_ioUring != nullptr) {
+        _ioUring->remove(fd);
+        // The poll request keeps the fd open in the kernel, the caller is likely to close it right away.
+        // Removals made by the handlers are submitted together once the batch ends.
+        if (!_isDispatching) {
+            _ioUring->submitRemovals();
+        }
+        return;
+    }
+
     struct epoll_event ev{};
     ev.data.fd = fd;
     epoll_ctl(_epollFd, EPOLL_CTL_DEL, fd, &ev);
@@ -180,67 +1098,196 @@ void Epoll::_epollCtlDelete(int fd) const {
 // # MonitoredDescriptor members
 // ######################################################################################################################
 
-MonitoredDescriptor::MonitoredDescriptor(int monitoredFd) : monitoredFd(monitoredFd) {}
-
-bool MonitoredDescriptor::hasHandler(uint32_t eventType) const {
-    switch (eventType) {
-        case EPOLLIN:
-            return IN_handler != nullptr;
-        case EPOLLOUT:
-            return OUT_handler != nullptr;
-        case EPOLLRDHUP:
-            return RDHUP_handler != nullptr;
-        case EPOLLPRI:
-            return PRI_handler != nullptr;
-        case EPOLLERR:
-            return ERR_handler != nullptr;
-        case EPOLLHUP:
-            return HUP_handler != nullptr;
-        default:
-            return false;
+template<typename Traits>
+BasicMonitoredDescriptor<Traits>::BasicMonitoredDescriptor(int monitoredFd) : monitoredFd(monitoredFd) {}
+
+// Out of line, Connection is only declared in the header
+template<typename Traits>
+BasicMonitoredDescriptor<Traits>::~BasicMonitoredDescriptor() = default;
+
+template<typename Traits>
+void BasicMonitoredDescriptor<Traits>::setHandler(uint32_t eventTypes, EventHandler handler) {
+    eventTypes &= allEventTypesMask;
+
+    // Detach these event types from their current handlers, a handler which serves no event type anymore is released
+    uint32_t remainingEvents = eventTypes & _handlerMask;
+    while (remainingEvents != 0) {
+        const uint32_t evt = 1u << __builtin_ctz(remainingEvents);
+        remainingEvents &= remainingEvents - 1;
+
+        const uint8_t index = _handlerIndex[_getEventIndex(evt)];
+        _handlerEvents[index] &= ~evt;
+        if (_handlerEvents[index] == 0) {
+            _getHandlerAt(index) = nullptr;
+        }
+    }
+    _handlerMask &= ~eventTypes;
+
+    if (eventTypes == 0 || handler == nullptr)
+        return;
+
+    // There is always a free position, every stored handler serves at least one of the event types
+    uint8_t index = 0;
+    while (_handlerEvents[index] != 0) {
+        index++;
+    }
+
+    if (index >= INLINE_HANDLERS_NUM && _extraHandlers == nullptr) {
+        _extraHandlers = std::make_unique<ExtraHandlers>();
+    }
+
+    _getHandlerAt(index) = std::move(handler);
+    _handlerEvents[index] = static_cast<uint16_t>(eventTypes);
+    _handlerMask |= eventTypes;
+
+    remainingEvents = eventTypes;
+    while (remainingEvents != 0) {
+        const uint32_t evt = 1u << __builtin_ctz(remainingEvents);
+        remainingEvents &= remainingEvents - 1;
+        _handlerIndex[_getEventIndex(evt)] = index;
     }
 }
 
-void MonitoredDescriptor::setHandler(uint32_t eventType, std::function<void(int)> handler) {
-    switch (eventType) {
-        case EPOLLIN:
-            IN_handler = std::move(handler);
-            return;
-        case EPOLLOUT:
-            OUT_handler = std::move(handler);
-            return;
-        case EPOLLRDHUP:
-            RDHUP_handler = std::move(handler);
-            return;
-        case EPOLLPRI:
-            PRI_handler = std::move(handler);
-            return;
-        case EPOLLERR:
-            ERR_handler = std::move(handler);
-            return;
-        case EPOLLHUP:
-            HUP_handler = std::move(handler);
-            return;
-        default:
-            return;
+template<typename Traits>
+void BasicMonitoredDescriptor<Traits>::setCombinedHandler(uint32_t eventTypes, CombinedEventHandler handler) {
+    eventTypes &= allEventTypesMask;
+
+    if (eventTypes == 0 || handler == nullptr) {
+        _combinedHandler = nullptr;
+        _combinedHandlerMask = 0;
+    } else {
+        _combinedHandler = std::move(handler);
+        _combinedHandlerMask = eventTypes;
+    }
+}
+
+template<typename Traits>
+typename BasicMonitoredDescriptor<Traits>::EventHandler &BasicMonitoredDescriptor<Traits>::getHandler(uint32_t eventType) {
+    if ((eventType & _handlerMask) == 0 || (eventType & (eventType - 1)) != 0) {
+        throw std::runtime_error("Epoll::MonitoredDescriptor::getHandler: ERROR - passed eventType is invalid or has no handler.");
+    }
+    return _getHandlerAt(_handlerIndex[_getEventIndex(eventType)]);
+}
+
+// # DescriptorTable members
+// ######################################################################################################################
+
+template<typename Record>
+Record &BasicDescriptorTable<Record>::at(int fd) {
+    Record *md = find(fd);
+    if (md == nullptr) {
+        throw std::out_of_range("Epoll::DescriptorTable::at: ERROR - file descriptor FD" + std::to_string(fd) + " is not monitored.");
+    }
+    return *md;
+}
+
+template<typename Record>
+const Record &BasicDescriptorTable<Record>::at(int fd) const {
+    const Record *md = find(fd);
+    if (md == nullptr) {
+        throw std::out_of_range("Epoll::DescriptorTable::at: ERROR - file descriptor FD" + std::to_string(fd) + " is not monitored.");
     }
+    return *md;
 }
 
-std::function<void(int)> &MonitoredDescriptor::getHandler(uint32_t eventType) {
-    switch (eventType) {
-        case EPOLLIN:
-            return IN_handler;
-        case EPOLLOUT:
-            return OUT_handler;
-        case EPOLLRDHUP:
-            return RDHUP_handler;
-        case EPOLLPRI:
-            return PRI_handler;
-        case EPOLLERR:
-            return ERR_handler;
-        case EPOLLHUP:
-            return HUP_handler;
-        default:
-            throw std::runtime_error("Epoll::MonitoredDescriptor::getHandler: ERROR - passed eventType is invalid.");
+template<typename Record>
+Record &BasicDescriptorTable<Record>::emplace(int fd) {
+    if (fd < 0) {
+        throw std::out_of_range("Epoll::DescriptorTable::emplace: ERROR - invalid file descriptor FD" + std::to_string(fd) + ".");
     }
+
+    if (static_cast<size_t>(fd) >= _slots.size()) {
+        _slots.resize(std::max({static_cast<size_t>(fd) + 1, _slots.size() * 2, MIN_TABLE_SIZE}));
+    }
+
+    Slot &slot = _slots[fd];
+    if (slot.entry == nullptr) {
+        slot.entry = makeSlabPtr<value_type>(_descriptorPool, std::piecewise_construct, std::forward_as_tuple(fd), std::forward_as_tuple(fd));
+        slot.generation = _nextGeneration(slot.generation);
+        _size++;
+    }
+    return slot.entry->second;
+}
+
+template<typename Record>
+bool BasicDescriptorTable<Record>::erase(int fd) {
+    return detach(fd) != nullptr;
 }
+
+template<typename Record>
+SlabPtr<typename BasicDescriptorTable<Record>::value_type> BasicDescriptorTable<Record>::detach(int fd) {
+    if (find(fd) == nullptr)
+        return nullptr;
+
+    Slot &slot = _slots[fd];
+    SlabPtr<value_type> entry = std::move(slot.entry);
+    slot.generation = _nextGeneration(slot.generation);
+    _size--;
+    return entry;
+}
+
+template<typename Record>
+uint32_t BasicDescriptorTable<Record>::_nextGeneration(uint32_t generation) {
+    generation++;
+    if (generation == 0 || generation == INTERNAL_GENERATION)
+        generation = 1;
+    return generation;
+}
+
+template<typename Record>
+typename BasicDescriptorTable<Record>::const_iterator BasicDescriptorTable<Record>::begin() const {
+    return {_slots.data(), _slots.data() + _slots.size()};
+}
+
+template<typename Record>
+typename BasicDescriptorTable<Record>::const_iterator BasicDescriptorTable<Record>::end() const {
+    return {_slots.data() + _slots.size(), _slots.data() + _slots.size()};
+}
+
+template<typename Record>
+BasicDescriptorTable<Record>::const_iterator::const_iterator(const Slot *current, const Slot *end) : _current(current), _end(end) {
+    _skipEmptySlots();
+}
+
+template<typename Record>
+typename BasicDescriptorTable<Record>::const_iterator &BasicDescriptorTable<Record>::const_iterator::operator++() {
+    ++_current;
+    _skipEmptySlots();
+    return *this;
+}
+
+template<typename Record>
+typename BasicDescriptorTable<Record>::const_iterator BasicDescriptorTable<Record>::const_iterator::operator++(int) {
+    const_iterator previous = *this;
+    ++(*this);
+    return previous;
+}
+
+template<typename Record>
+void BasicDescriptorTable<Record>::const_iterator::_skipEmptySlots() {
+    while (_current != _end && _current->entry == nullptr) {
+        ++_current;
+    }
+}
+
+template class BasicMonitoredDescriptor<DefaultEpollTraits>;
+template class BasicMonitoredDescriptor<LevelTriggeredEpollTraits>;
+template class BasicMonitoredDescriptor<EdgeTriggeredEpollTraits>;
+
+template class BasicDescriptorTable<BasicMonitoredDescriptor<DefaultEpollTraits>>;
+template class BasicDescriptorTable<BasicMonitoredDescriptor<LevelTriggeredEpollTraits>>;
+template class BasicDescriptorTable<BasicMonitoredDescriptor<EdgeTriggeredEpollTraits>>;
+
+template class BasicEpoll<DefaultEpollTraits>;
+template class BasicEpoll<LevelTriggeredEpollTraits>;
+template class BasicEpoll<EdgeTriggeredEpollTraits>;
+
+#ifdef EPOLL_CPP_COROUTINES
+template class BasicReadinessAwaiter<DefaultEpollTraits>;
+template class BasicReadinessAwaiter<LevelTriggeredEpollTraits>;
+template class BasicReadinessAwaiter<EdgeTriggeredEpollTraits>;
+
+template class BasicSleepAwaiter<DefaultEpollTraits>;
+template class BasicSleepAwaiter<LevelTriggeredEpollTraits>;
+template class BasicSleepAwaiter<EdgeTriggeredEpollTraits>;
+#endif
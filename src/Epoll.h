@@ -1,67 +1,645 @@
 #pragma once
 
+#include "EpollTask.h"
+#include "InplaceFunction.h"
+#include "IoUringPoller.h"
+#include "MpscQueue.h"
+#include "RingBuffer.h"
+#include "SlabPool.h"
+#include "TimerQueue.h"
+#include "TimingWheel.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
 #include <functional>
+#include <iterator>
+#include <memory>
 #include <set>
+#include <signal.h>
 #include <sys/epoll.h>
+#include <sys/types.h>
+#include <thread>
+#include <tuple>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 constexpr static const std::array<uint32_t, 6> allEventTypes{EPOLLIN, EPOLLOUT, EPOLLRDHUP, EPOLLPRI, EPOLLERR, EPOLLHUP};
+constexpr static const uint32_t allEventTypesMask = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLPRI | EPOLLERR | EPOLLHUP;
 
-class MonitoredDescriptor {
+/**
+ * Kernel interface which Epoll uses to wait for events. Both backends have the same registration and dispatch semantics.
+ */
+enum class EpollBackend {
+    EPOLL,   // epoll_ctl() and epoll_wait() (or epoll_pwait2())
+    IO_URING // IORING_OP_POLL_ADD requests, registration changes are batched into the wait syscall (Linux 5.11+, 5.13+ edge triggered)
+};
+
+// Backend of Epoll instances which don't choose one, set by the EPOLL_CPP_IO_URING_DEFAULT CMake option
+#ifdef EPOLL_CPP_IO_URING_DEFAULT
+constexpr static const EpollBackend defaultEpollBackend = EpollBackend::IO_URING;
+#else
+constexpr static const EpollBackend defaultEpollBackend = EpollBackend::EPOLL;
+#endif
+
+// # Options of Epoll::addDescriptor(), the "| bitwise or notation" can be used to combine them
+// ######################################################################################################################
+
+/**
+ * The kernel will return a token made of the fd and the generation of its DescriptorTable slot with every event.
+ * Events which were queued for a descriptor that has since been removed (and its fd number possibly reused) are then dropped.
+ */
+constexpr static const uint32_t DESCRIPTOR_TAG_EVENTS = 1u << 0;
+
+/**
+ * Registers the fd with EPOLLEXCLUSIVE. Use it when several Epoll instances watch the same fd (typically a shared listening socket),
+ * an event then wakes up only one (or a few) of them instead of all of them.
+ * The kernel allows only EPOLLIN, EPOLLOUT, EPOLLERR and EPOLLHUP handlers for exclusive descriptors.
+ */
+constexpr static const uint32_t DESCRIPTOR_EXCLUSIVE = 1u << 1;
+
+/**
+ * Event types which the kernel accepts together with EPOLLEXCLUSIVE
+ */
+constexpr static const uint32_t exclusiveEventTypesMask = EPOLLIN | EPOLLOUT | EPOLLERR | EPOLLHUP;
+
+/**
+ * Handler of a single event type, receives the fd. Captures of a lambda must fit into 2 pointers, nothing is heap allocated
+ * unless the handler is made by EventHandler::allocate().
+ */
+using EventHandler = InplaceFunction<void(int)>;
+
+/**
+ * Combined handler, receives the fd and all occurred events. Same capture limit as EventHandler.
+ */
+using CombinedEventHandler = InplaceFunction<void(int, uint32_t)>;
+
+/**
+ * Completion handler of Epoll::asyncRead() and Epoll::asyncWrite(), receives the fd and the number of transferred bytes
+ * (0 means end of file for a read) or -errno if the operation failed. Same capture limit as EventHandler.
+ */
+using AsyncIoHandler = InplaceFunction<void(int, ssize_t)>;
+
+template<typename Traits>
+class BasicConnection;
+
+/**
+ * Data handler of a Connection, called after new data was read into Connection::getInput()
+ */
+template<typename Traits>
+using BasicConnectionDataHandler = InplaceFunction<void(BasicConnection<Traits> &)>;
+
+/**
+ * Close handler of a Connection, called once right before its fd is closed. The error is 0 if the connection was closed by
+ * Connection::close() or by the peer, otherwise the errno value which failed the socket.
+ */
+template<typename Traits>
+using BasicConnectionCloseHandler = InplaceFunction<void(BasicConnection<Traits> &, int)>;
+
+/**
+ * Pending async operations of one descriptor, created by the first Epoll::asyncRead() or Epoll::asyncWrite() call for it
+ */
+struct AsyncIoState {
+    struct Read {
+        char *buffer = nullptr;
+        size_t size = 0;
+        AsyncIoHandler handler = nullptr;
+    };
+
+    struct Write {
+        const char *data = nullptr;
+        size_t size = 0;
+        size_t written = 0;
+        AsyncIoHandler handler = nullptr;
+    };
+
+    // An operation of size 0 only waits for the readiness, it's how the coroutine awaiters are resumed
+    Read read{};
+    Write write{};
+    // Readiness reported by the kernel and not used up yet (an operation didn't hit EAGAIN since)
+    bool isReadable = false;
+    bool isWritable = false;
+    // The fd waits in Epoll::_readyAsyncFds
+    bool isQueued = false;
+    // Set while Epoll runs the operations, new operations started by their handlers then leave the interest to it
+    bool isRunning = false;
+    // Set when the state is created, other descriptors are switched to O_NONBLOCK and used by read() and write()
+    bool isSocket = true;
+};
+
+/**
+ * Record of one descriptor monitored by BasicEpoll, holds its handlers and its state
+ */
+template<typename Traits>
+class BasicMonitoredDescriptor {
 public:
-    explicit MonitoredDescriptor(int monitoredFd);
+    using EventHandler = typename Traits::EventHandler;
+
+    explicit BasicMonitoredDescriptor(int monitoredFd);
+
+    ~BasicMonitoredDescriptor();
 
     bool isInitialized = false;
+    bool isTagged = false;
+    bool isExclusive = false;
     const int monitoredFd;
+    // nullptr until an async operation is started for this descriptor, allocated from the slab pool of Epoll
+    SlabPtr<AsyncIoState> asyncIo{};
+    // Set by Epoll::addConnection(), the connection lives as long as the record
+    SlabPtr<BasicConnection<Traits>> connection{};
 
     /**
      * Checks if this eventType has a handler function assigned to it
      */
-    bool hasHandler(uint32_t eventType) const;
+    bool hasHandler(uint32_t eventType) const {
+        return eventType != 0 && (_handlerMask & eventType) == eventType;
+    }
 
     /**
-     * Sets an event handler of a SINGLE eventType (don't use | bitwise or notation)
+     * Event types which have a handler function assigned, in the same bit format as epoll_event.events
      */
-    void setHandler(uint32_t eventType, std::function<void(int)> handler);
+    uint32_t getHandlerMask() const { return _handlerMask; }
+
+    /**
+     * Sets the event handler of one or more event types ("| bitwise or notation" can be used).
+     * A handler set for several event types at once is stored only once. A null handler removes the handlers of these event types.
+     */
+    void setHandler(uint32_t eventTypes, EventHandler handler);
 
     /**
      * Gets the events handler associated with this SINGLE eventType
      */
-    std::function<void(int)>& getHandler(uint32_t eventType);
+    EventHandler& getHandler(uint32_t eventType);
+
+    /**
+     * Same as getHandler() without the checks, for the dispatch loop.
+     * eventType has to be a SINGLE event type which has a handler (its bit is set in getHandlerMask()).
+     */
+    EventHandler &getHandlerUnchecked(uint32_t eventType) {
+        const uint8_t index = _handlerIndex[_getEventIndex(eventType)];
+        if (__builtin_expect(index < INLINE_HANDLERS_NUM, 1))
+            return _handlers[index];
+        return (*_extraHandlers)[index - INLINE_HANDLERS_NUM];
+    }
+
+    /**
+     * Sets the combined handler, which is called once per ready fd with all occurred events.
+     * Replaces the previous combined handler (and its event types). A null handler or an empty eventTypes removes it.
+     */
+    void setCombinedHandler(uint32_t eventTypes, CombinedEventHandler handler);
+
+    /**
+     * Event types which trigger the combined handler
+     */
+    uint32_t getCombinedHandlerMask() const { return _combinedHandlerMask; }
+
+    CombinedEventHandler& getCombinedHandler() { return _combinedHandler; }
+
+    /**
+     * All event types this descriptor listens for, either by a single event handler or the combined handler
+     */
+    uint32_t getInterestMask() const { return _handlerMask | _combinedHandlerMask; }
 
 private:
-    // No need to use unordered_map since there are only 6 possible event types
-    std::function<void(int)> IN_handler = nullptr;
-    std::function<void(int)> OUT_handler = nullptr;
-    std::function<void(int)> RDHUP_handler = nullptr;
-    std::function<void(int)> PRI_handler = nullptr;
-    std::function<void(int)> ERR_handler = nullptr;
-    std::function<void(int)> HUP_handler = nullptr;
+    // Most descriptors have one or two distinct handlers (for example reading and hang up), these are stored in the record
+    static constexpr size_t INLINE_HANDLERS_NUM = 2;
+
+    using ExtraHandlers = std::array<EventHandler, allEventTypes.size() - INLINE_HANDLERS_NUM>;
+
+    // Distinct handler functions, each of them serves the event types in _handlerEvents at the same position
+    std::array<EventHandler, INLINE_HANDLERS_NUM> _handlers{};
+    // Positions past the inline handlers, allocated once a third distinct handler is set and kept until the record is destroyed
+    std::unique_ptr<ExtraHandlers> _extraHandlers{};
+    // All handled event types fit into 16 bits (EPOLLRDHUP is the highest one)
+    std::array<uint16_t, allEventTypes.size()> _handlerEvents{};
+    // Position in _handlers for every event type, indexed by _getEventIndex()
+    std::array<uint8_t, allEventTypes.size()> _handlerIndex{};
+    uint32_t _handlerMask = 0;
+
+    CombinedEventHandler _combinedHandler = nullptr;
+    uint32_t _combinedHandlerMask = 0;
+
+    /**
+     * Maps the bit position of a SINGLE eventType to an index of _handlerIndex.
+     * EPOLLIN, EPOLLPRI, EPOLLOUT, EPOLLERR and EPOLLHUP occupy bits 0-4, EPOLLRDHUP is the only higher bit (13).
+     */
+    static unsigned _getEventIndex(uint32_t eventType) {
+        const unsigned bit = __builtin_ctz(eventType);
+        return bit < 5 ? bit : 5;
+    }
+
+    EventHandler &_getHandlerAt(uint8_t index) {
+        return index < INLINE_HANDLERS_NUM ? _handlers[index] : (*_extraHandlers)[index - INLINE_HANDLERS_NUM];
+    }
 };
 
-class Epoll {
+/**
+ * Flat table of descriptor records indexed directly by the fd number, the default table of BasicEpoll.
+ * File descriptors are small dense integers, so a lookup is a single array load instead of a hash probe.
+ * Every slot has a generation counter which changes each time a record is added to or removed from the slot,
+ * this allows detecting events which belong to an already removed descriptor whose fd number was reused.
+ */
+template<typename Record>
+class BasicDescriptorTable {
 public:
-    Epoll(bool isEdgeTriggered);
+    /**
+     * Element of the table, the same as the element of the std::unordered_map<int, MonitoredDescriptor> it replaced,
+     * so "for (auto &[fd, md] : epoll.getMonitoredFds())" keeps working
+     */
+    using value_type = std::pair<const int, Record>;
+
+private:
+    struct Slot {
+        SlabPtr<value_type> entry{};
+        uint32_t generation = 0;
+    };
+
+public:
+    /**
+     * Read-only iterator over the occupied slots of the table, in the order of the fd numbers
+     */
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = BasicDescriptorTable::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type *;
+        using reference = const value_type &;
+
+        const_iterator(const Slot *current, const Slot *end);
+
+        reference operator*() const { return *_current->entry; }
+
+        pointer operator->() const { return _current->entry.get(); }
+
+        const_iterator &operator++();
+
+        const_iterator operator++(int);
+
+        bool operator==(const const_iterator &other) const { return _current == other._current; }
+
+        bool operator!=(const const_iterator &other) const { return _current != other._current; }
+
+    private:
+        const Slot *_current;
+        const Slot *_end;
+
+        void _skipEmptySlots();
+    };
+
+    /**
+     * Returns the record of this fd, or nullptr if the fd isn't in the table
+     */
+    Record *find(int fd) {
+        return static_cast<size_t>(fd) < _slots.size() && _slots[fd].entry != nullptr ? &_slots[fd].entry->second : nullptr;
+    }
+
+    const Record *find(int fd) const {
+        return static_cast<size_t>(fd) < _slots.size() && _slots[fd].entry != nullptr ? &_slots[fd].entry->second : nullptr;
+    }
+
+    /**
+     * Returns the record of this fd only if its slot still has this generation, nullptr otherwise
+     */
+    Record *find(int fd, uint32_t generation) {
+        return getGeneration(fd) == generation ? find(fd) : nullptr;
+    }
+
+    /**
+     * Returns the record of this fd, throws std::out_of_range if the fd isn't in the table
+     */
+    Record &at(int fd);
+
+    const Record &at(int fd) const;
+
+    size_t count(int fd) const { return find(fd) != nullptr ? 1 : 0; }
+
+    size_t size() const { return _size; }
+
+    bool empty() const { return _size == 0; }
+
+    /**
+     * Generation of the slot belonging to this fd, changes every time a record is added to or removed from the slot
+     */
+    uint32_t getGeneration(int fd) const {
+        return static_cast<size_t>(fd) < _slots.size() ? _slots[fd].generation : 0;
+    }
+
+    /**
+     * Value of epoll_event.data for events of this fd. The fd is stored in the lower 32 bits,
+     * the upper 32 bits hold the slot generation if the descriptor is tagged, or 0 otherwise.
+     */
+    static uint64_t makeEventToken(int fd, uint32_t generation) {
+        return (static_cast<uint64_t>(generation) << 32) | static_cast<uint32_t>(fd);
+    }
+
+    static int getTokenFd(uint64_t token) { return static_cast<int>(static_cast<uint32_t>(token)); }
+
+    static uint32_t getTokenGeneration(uint64_t token) { return static_cast<uint32_t>(token >> 32); }
+
+    // Generation 0 marks an untagged token, this one marks the internal descriptors of Epoll which aren't in the table
+    static constexpr uint32_t INTERNAL_GENERATION = UINT32_MAX;
+
+    /**
+     * Creates a new record for this fd, if the fd is already in the table the existing record is returned instead.
+     * The table grows geometrically, the records themselves never move.
+     */
+    Record &emplace(int fd);
+
+    /**
+     * Removes the record of this fd
+     * @return false if the fd wasn't in the table
+     */
+    bool erase(int fd);
+
+    /**
+     * Removes the record of this fd from the table, but keeps it alive and hands it over to the caller
+     * @return nullptr if the fd wasn't in the table
+     */
+    SlabPtr<value_type> detach(int fd);
+
+    const_iterator begin() const;
+
+    const_iterator end() const;
+
+private:
+    static constexpr size_t MIN_TABLE_SIZE = 64;
+
+    static uint32_t _nextGeneration(uint32_t generation);
+
+    // Storage of the records, declared before the slots so that it outlives them
+    SlabPool _descriptorPool{sizeof(value_type), alignof(value_type)};
+    std::vector<Slot> _slots{};
+    size_t _size = 0;
+};
+
+/**
+ * Trigger mode of BasicEpoll, fixed by its traits or chosen at runtime
+ */
+enum class EpollTriggerMode {
+    RUNTIME, // Chosen by the isEdgeTriggered argument of the constructor
+    LEVEL,
+    EDGE
+};
+
+/**
+ * Compile-time parameters of BasicEpoll. A fixed trigger mode removes the mode checks from every registration, read and write
+ * (and from Connection), a fixed batch size removes the batch adaptation, so the compiler can fold them into the loop.
+ * @tparam TriggerMode see EpollTriggerMode
+ * @tparam BatchSize max number of events fetched by one wait, 0 adapts it between the sizes passed to the constructor
+ * @tparam Handler handler of a single event type, it has to be callable with the fd and comparable with nullptr
+ * @tparam Table table of the descriptor records indexed by the fd, with the same interface as BasicDescriptorTable
+ */
+template<EpollTriggerMode TriggerMode, int BatchSize = 0, typename Handler = EventHandler, template<typename> class Table = BasicDescriptorTable>
+struct EpollTraits {
+    static constexpr EpollTriggerMode triggerMode = TriggerMode;
+    static constexpr int batchSize = BatchSize;
+
+    using EventHandler = Handler;
+
+    template<typename Record>
+    using DescriptorTable = Table<Record>;
+};
+
+// The trigger mode is a constructor argument, like it always was for Epoll
+using DefaultEpollTraits = EpollTraits<EpollTriggerMode::RUNTIME>;
+using LevelTriggeredEpollTraits = EpollTraits<EpollTriggerMode::LEVEL>;
+using EdgeTriggeredEpollTraits = EpollTraits<EpollTriggerMode::EDGE>;
+
+template<typename Traits>
+class BasicEpoll;
+
+using Epoll = BasicEpoll<DefaultEpollTraits>;
+using LevelTriggeredEpoll = BasicEpoll<LevelTriggeredEpollTraits>;
+using EdgeTriggeredEpoll = BasicEpoll<EdgeTriggeredEpollTraits>;
+
+using MonitoredDescriptor = BasicMonitoredDescriptor<DefaultEpollTraits>;
+using DescriptorTable = BasicDescriptorTable<MonitoredDescriptor>;
+using Connection = BasicConnection<DefaultEpollTraits>;
+using ConnectionDataHandler = BasicConnectionDataHandler<DefaultEpollTraits>;
+using ConnectionCloseHandler = BasicConnectionCloseHandler<DefaultEpollTraits>;
+
+#ifdef EPOLL_CPP_COROUTINES
+/**
+ * Awaiter of Epoll::readable() and Epoll::writable(), the coroutine is resumed by the event loop once the fd is ready
+ */
+template<typename Traits>
+class BasicReadinessAwaiter {
+public:
+    BasicReadinessAwaiter(BasicEpoll<Traits> &epoll, int fd, uint32_t eventType) : _epoll(epoll), _fd(fd), _eventType(eventType) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle);
+
+    void await_resume() const noexcept {}
+
+private:
+    BasicEpoll<Traits> &_epoll;
+    const int _fd;
+    const uint32_t _eventType;
+};
+
+/**
+ * Awaiter of Epoll::sleep(), the coroutine is resumed by the event loop once the duration elapses
+ */
+template<typename Traits>
+class BasicSleepAwaiter {
+public:
+    BasicSleepAwaiter(BasicEpoll<Traits> &epoll, std::chrono::milliseconds duration) : _epoll(epoll), _duration(duration) {}
+
+    bool await_ready() const noexcept { return _duration <= std::chrono::milliseconds::zero(); }
+
+    void await_suspend(std::coroutine_handle<> handle);
+
+    void await_resume() const noexcept {}
+
+private:
+    BasicEpoll<Traits> &_epoll;
+    const std::chrono::milliseconds _duration;
+};
+
+using ReadinessAwaiter = BasicReadinessAwaiter<DefaultEpollTraits>;
+using SleepAwaiter = BasicSleepAwaiter<DefaultEpollTraits>;
+#endif
+
+/**
+ * Wrapper around a Linux epoll instance which calls registered handler functions when events of monitored descriptors occur.
+ *
+ * Thread safety: the event loop (run() or waitForEvents()) and the handlers run on a single thread. post() and stop() can be called from any thread.
+ * addDescriptor(), removeDescriptor(), addEventHandler() and removeEventHandler() can be called from any thread too, once
+ * waitForEvents() was called for the first time: a call from a foreign thread is deferred and applied by the loop thread between
+ * two event batches, in the order of the calls. Errors of a deferred call (for example a missing descriptor) are thrown by waitForEvents().
+ * The getters must only be used from the loop thread.
+ *
+ * The Traits (see EpollTraits) fix the trigger mode, the batch size, the handler type and the descriptor table at compile time.
+ * Epoll.cpp instantiates Epoll (DefaultEpollTraits), LevelTriggeredEpoll and EdgeTriggeredEpoll, other traits need their own
+ * "template class BasicEpoll<...>" line there and in Connection.cpp.
+ */
+template<typename Traits>
+class BasicEpoll {
+public:
+    static constexpr int DEFAULT_BATCH_SIZE = Traits::batchSize != 0 ? Traits::batchSize : 64;
+    static constexpr int DEFAULT_MAX_BATCH_SIZE = Traits::batchSize != 0 ? Traits::batchSize : 4096;
+
+    using Clock = std::chrono::steady_clock;
+    using TimerId = TimerQueue::TimerId;
+    using TimeoutId = TimingWheel::TimeoutId;
+    using TimeoutHandler = TimingWheel::TimeoutHandler;
+
+    using EventHandler = typename Traits::EventHandler;
+    using MonitoredDescriptor = BasicMonitoredDescriptor<Traits>;
+    using DescriptorTable = typename Traits::template DescriptorTable<MonitoredDescriptor>;
+    using Connection = BasicConnection<Traits>;
+    using ConnectionDataHandler = BasicConnectionDataHandler<Traits>;
+    using ConnectionCloseHandler = BasicConnectionCloseHandler<Traits>;
+
+    /**
+     * Constructor of the traits whose trigger mode is chosen at runtime (EpollTriggerMode::RUNTIME)
+     * @param isEdgeTriggered all descriptors will be registered with EPOLLET and set to non-blocking mode
+     * @param initialBatchSize max number of events returned by a single epoll_wait() call, the batch never shrinks below this
+     * @param maxBatchSize the batch grows up to this size while epoll_wait() keeps returning full batches
+     * @param backend kernel interface used to wait for events, throws if the kernel doesn't support it
+     */
+    template<EpollTriggerMode Mode = Traits::triggerMode, std::enable_if_t<Mode == EpollTriggerMode::RUNTIME, int> = 0>
+    explicit BasicEpoll(bool isEdgeTriggered, int initialBatchSize = DEFAULT_BATCH_SIZE, int maxBatchSize = DEFAULT_MAX_BATCH_SIZE,
+                        EpollBackend backend = defaultEpollBackend)
+            : BasicEpoll(ConstructorTag{}, isEdgeTriggered, initialBatchSize, maxBatchSize, backend) {}
+
+    /**
+     * Constructor of the traits with a fixed trigger mode, the parameters are the same as above.
+     * With a fixed batch size of the traits the batch sizes must be left at their defaults.
+     */
+    template<EpollTriggerMode Mode = Traits::triggerMode, std::enable_if_t<Mode != EpollTriggerMode::RUNTIME, int> = 0>
+    explicit BasicEpoll(int initialBatchSize = DEFAULT_BATCH_SIZE, int maxBatchSize = DEFAULT_MAX_BATCH_SIZE,
+                        EpollBackend backend = defaultEpollBackend)
+            : BasicEpoll(ConstructorTag{}, Mode == EpollTriggerMode::EDGE, initialBatchSize, maxBatchSize, backend) {}
+
+    // The instance owns the epoll fd and the handlers, it can't be copied
+    BasicEpoll(const BasicEpoll &) = delete;
+
+    BasicEpoll &operator=(const BasicEpoll &) = delete;
 
     /**
      * Will add a file descriptor to this epoll.
      * Fd will be set to non-blocking if epoll is in edge triggered mode.
      * @param fd the file descriptor number
+     * @param options DESCRIPTOR_* flags, for example DESCRIPTOR_TAG_EVENTS
      */
-    void addDescriptor(int fd);
+    void addDescriptor(int fd, uint32_t options = 0);
 
     /**
      * This method is called automatically if you've added event handlers for "EPOLLRDHUP | EPOLLHUP".
      * Otherwise in order to free memory you have to call this manually once your fd closes.
+     * Can be called from a handler, even for the fd being handled. The descriptor stops receiving events right away, remaining
+     * events of the current batch which belong to it are dropped, its record (and handlers) is released after the batch.
      */
     void removeDescriptor(int monitoredFd);
 
     /**
-     * Blocks thread until event occurs, or the timeout expired
-     * @param timeout Timeout in ms. Use -1 for infinite timeout
+     * Blocks thread until event occurs, or the timeout expired. Expired timers and timeouts are handled in the same pass.
+     * The wait never outlasts the earliest pending timer or timeout, so the loop wakes up only when there is something to do.
+     * epoll_pwait2() is used where the kernel supports it, timers then wake the loop with nanosecond precision,
+     * otherwise epoll_wait() is used and the wakeup is rounded up to whole milliseconds.
+     * @param timeout Timeout in ms. Use -1 for infinite timeout (the loop still wakes up for timers and timeouts)
      */
     void waitForEvents(int timeout = -1);
 
+    /**
+     * Same as waitForEvents(int), with a timeout of nanosecond resolution for latency sensitive loops.
+     * The precision is kept only where the kernel supports epoll_pwait2() (Linux 5.11+), older kernels fall back to epoll_wait()
+     * at runtime and the timeout is then rounded up to whole milliseconds.
+     * @param timeout a negative timeout waits indefinitely (the loop still wakes up for timers and timeouts)
+     */
+    void waitForEvents(std::chrono::nanoseconds timeout);
+
+    /**
+     * Runs the event loop on the calling thread until stop() is called, or until nothing is left to wait for
+     * (no descriptors, timers and timeouts). Signal handlers alone don't keep the loop running.
+     */
+    void run();
+
+    /**
+     * Runs a single pass of the event loop (see waitForEvents()), use it to drive the loop from your own loop.
+     * @return false without waiting if the loop was stopped or has nothing left to wait for, true after the pass
+     */
+    bool runOnce();
+
+    /**
+     * Same as run(), but returns once the duration elapses at the latest
+     */
+    void runFor(std::chrono::nanoseconds duration);
+
+    /**
+     * Makes run() and runFor() return after the current pass (the next runOnce() returns false). Thread safe.
+     * A call from another thread interrupts the wait through the internal eventfd. If the loop isn't running,
+     * the next run() returns right away. Queued posted tasks stay queued for the next run.
+     */
+    void stop();
+
+    /**
+     * Runs the task on the thread which calls waitForEvents(), during its next (or current) pass. Thread safe.
+     * The task is pushed to a lock-free queue and the loop is woken up through an internal eventfd.
+     * Wakeups are coalesced, many posts before the loop gets to them cost a single eventfd write and read.
+     */
+    void post(std::function<void()> task);
+
+    /**
+     * Calls the callback on the loop thread once the duration elapses, in the same waitForEvents() pass as the descriptor events.
+     * No syscall is made, waitForEvents() limits its wait to the earliest timer deadline. Thread safe.
+     * @param duration time until the (first) expiry, must be positive for a repeating timer
+     * @param callback a function which will be called once the timer expires
+     * @param repeat call the callback every duration until the timer is cancelled
+     * @return id of the timer for cancelTimer()
+     */
+    TimerId addTimer(std::chrono::nanoseconds duration, std::function<void()> callback, bool repeat = false);
+
+    /**
+     * Cancels the timer, does nothing if it already expired. Thread safe.
+     */
+    void cancelTimer(TimerId id);
+
+    /**
+     * Adds a one-shot timeout with 1 ms resolution, meant for large numbers of timeouts which are frequently reset or cancelled
+     * (for example an idle timeout of every connection). Unlike addTimer(), adding, resetting and cancelling is O(1) and
+     * never makes a syscall, the timeouts are kept in a timing wheel which is advanced whenever waitForEvents() returns.
+     * waitForEvents() limits its wait so that it wakes up for the next expiry.
+     * Must be called on the loop thread (from a handler, a timer or a posted task) or before the loop starts.
+     * @param handler a function which will be called once the timeout expires, it can capture up to two pointers
+     * @return id of the timeout for resetTimeout() and cancelTimeout()
+     */
+    TimeoutId addTimeout(std::chrono::milliseconds timeout, TimeoutHandler handler);
+
+    /**
+     * Restarts a pending timeout, it will expire after the new timeout counted from now. Loop thread only.
+     * @return false if the timeout already expired or was cancelled
+     */
+    bool resetTimeout(TimeoutId id, std::chrono::milliseconds timeout);
+
+    /**
+     * Loop thread only.
+     * @return false if the timeout already expired or was cancelled
+     */
+    bool cancelTimeout(TimeoutId id);
+
+    /**
+     * Handles the signal on the loop thread, in the same waitForEvents() pass as the descriptor events. Unlike a <csignal> handler,
+     * the callback can do anything (use this Epoll, allocate, log), for example drain the server on SIGTERM or reload config on SIGHUP.
+     * The signal is blocked in the calling thread and read from one internal signalfd shared by all signal handlers.
+     * Threads inherit the signal mask, so add the handlers before starting other threads, otherwise the signal can still be
+     * delivered to a thread which doesn't block it. Adding another handler for the same signal replaces the previous one.
+     * Must be called on the loop thread or before the loop starts.
+     * @param callback a function which receives the signal number
+     */
+    void addSignalHandler(int signo, std::function<void(int)> callback);
+
+    /**
+     * Stops handling the signal, it's unblocked again unless it was already blocked before addSignalHandler(). Loop thread only.
+     */
+    void removeSignalHandler(int signo);
+
     /**
      * Will add a handler function to event of certain fd which is monitored by this epoll.
      * The "| bitwise or notation" can be used to add handler to multiple events at once, for example: "EPOLLIN | EPOLLOUT".
@@ -69,40 +647,352 @@ public:
      * @param eventType the event unit32_t as specified in linux header <sys/epoll.h>
      * @param eventHandler a function which will be called once this event occurs
      */
-    void addEventHandler(int monitoredFd, uint32_t eventType, std::function<void(int)> eventHandler);
+    void addEventHandler(int monitoredFd, uint32_t eventType, EventHandler eventHandler);
+
+    /**
+     * Will add a plain function as a handler of certain events of fd which is monitored by this epoll.
+     * Only the function and the context pointer are stored, the dispatch jumps to the function straight from a shared invoker,
+     * which makes this the cheapest kind of handler for servers that register the same few functions on every connection.
+     * @param monitoredFd fd which was previously registered by addDescriptor()
+     * @param eventType the event unit32_t as specified in linux header <sys/epoll.h>, "| bitwise or notation" can be used
+     * @param eventHandler a function which receives the fd and the context pointer once this event occurs
+     * @param context any pointer, for example to the connection state, it's passed to eventHandler unchanged
+     */
+    void addEventHandler(int monitoredFd, uint32_t eventType, void (*eventHandler)(int, void *), void *context);
+
+    /**
+     * Will add a combined handler function to fd which is monitored by this epoll. Unlike the single event handlers, the combined
+     * handler is called only ONCE per ready fd and receives all events which occurred (the raw epoll_event.events value),
+     * so a readable, writable and hung up socket can be handled in one pass.
+     * Each descriptor has at most one combined handler, adding another one replaces it. The combined handler is called before
+     * the single event handlers of the same fd.
+     * @param monitoredFd fd which was previously registered by addDescriptor()
+     * @param eventType the events which trigger the handler, use "| bitwise or notation" for multiple events
+     * @param eventHandler a function which receives the fd and the occurred events
+     */
+    void addEventHandler(int monitoredFd, uint32_t eventType, CombinedEventHandler eventHandler);
+
+    /**
+     * Passing nullptr as the handler removes the handlers of the events, the same as removeEventHandler()
+     */
+    void addEventHandler(int monitoredFd, uint32_t eventType, std::nullptr_t) { removeEventHandler(monitoredFd, eventType); }
 
     void removeEventHandler(int monitoredFd, uint32_t eventType);
 
-    const std::unordered_map<int, MonitoredDescriptor>& getMonitoredFds() const;
+    /**
+     * Reads from the fd once it's readable and calls the handler with the number of bytes read (0 at the end of file) or -errno.
+     * Epoll makes the non-blocking syscalls itself: in edge triggered mode it reads until the buffer is full or the fd has no more
+     * data (EAGAIN), and it remembers that the fd is still readable, so a read started later doesn't wait for an edge which
+     * already came. In level triggered mode a single read is made per readiness event.
+     * At most one read per fd can be pending, start the next one from the handler. The buffer must stay valid until the handler
+     * is called. Pending operations are dropped (without calling their handlers) when the descriptor is removed.
+     * Sockets are read with MSG_DONTWAIT, other descriptors (pipes for example) are switched to O_NONBLOCK by the first async
+     * operation, the flag is shared by all duplicates of the fd. Loop thread only.
+     * @param fd fd which was previously registered by addDescriptor()
+     */
+    void asyncRead(int fd, void *buffer, size_t size, AsyncIoHandler handler);
+
+    /**
+     * Writes all data to the fd and then calls the handler with the number of bytes written, or with -errno if writing failed.
+     * The data is written right away if the fd is known to be writable, otherwise once EPOLLOUT occurs, further parts are
+     * written as the fd becomes writable again. Sockets are written with MSG_NOSIGNAL, a closed peer gives -EPIPE instead of SIGPIPE.
+     * At most one write per fd can be pending, the data must stay valid until the handler is called. Loop thread only.
+     * @param fd fd which was previously registered by addDescriptor()
+     */
+    void asyncWrite(int fd, const void *data, size_t size, AsyncIoHandler handler);
 
+    /**
+     * Turns the stream socket into a buffered Connection owned by this Epoll, see the Connection class. The fd is added by
+     * addDescriptor() if it isn't monitored yet, its reading starts right away. Don't start other async operations for the fd and
+     * close it by Connection::close(), which also removes it. Loop thread only.
+     * @param onData called on the epoll thread every time new data is read
+     * @param onClose optional, called once before the fd is closed
+     * @return the connection, valid until it's closed
+     */
+    Connection &addConnection(int fd, ConnectionDataHandler onData, ConnectionCloseHandler onClose = nullptr);
+
+#ifdef EPOLL_CPP_COROUTINES
+    /**
+     * "co_await epoll.readable(fd)" suspends the coroutine until the fd is readable (or hung up), the event loop then resumes it
+     * directly from the dispatch of the event. Built on the same readiness tracking as asyncRead(): in edge triggered mode the
+     * coroutine must read until EAGAIN before it awaits again, otherwise it waits for the next edge.
+     * Only one coroutine can await each direction of a fd, a coroutine awaiting a removed descriptor is never resumed.
+     * Loop thread only, needs a C++20 build.
+     * @param fd fd which was previously registered by addDescriptor()
+     */
+    BasicReadinessAwaiter<Traits> readable(int fd) { return {*this, fd, EPOLLIN}; }
+
+    /**
+     * "co_await epoll.writable(fd)" suspends the coroutine until the fd is writable, see readable()
+     */
+    BasicReadinessAwaiter<Traits> writable(int fd) { return {*this, fd, EPOLLOUT}; }
+
+    /**
+     * "co_await epoll.sleep(duration)" suspends the coroutine for the duration, it's a timeout of the timing wheel (see addTimeout())
+     */
+    BasicSleepAwaiter<Traits> sleep(std::chrono::milliseconds duration) { return {*this, duration}; }
+#endif
+
+    const DescriptorTable& getMonitoredFds() const;
+
+    /**
+     * The epoll fd, -1 with the io_uring backend
+     */
     int getEpollFd() const;
 
-    int isEdgeTriggered() const;
+    EpollBackend getBackend() const;
+
+    int isEdgeTriggered() const {
+        if constexpr (Traits::triggerMode == EpollTriggerMode::RUNTIME)
+            return _isEdgeTriggered;
+        else
+            return Traits::triggerMode == EpollTriggerMode::EDGE;
+    }
+
+    /**
+     * Current max number of events fetched by one epoll_wait() call
+     */
+    int getBatchSize() const {
+        if constexpr (Traits::batchSize != 0)
+            return Traits::batchSize;
+        else
+            return _batchSize;
+    }
 
 private:
-    std::unordered_map<int, MonitoredDescriptor> _monitoredFds{};
+    struct ConstructorTag {};
+
+    BasicEpoll(ConstructorTag, bool isEdgeTriggered, int initialBatchSize, int maxBatchSize, EpollBackend backend);
+
+    // Per-descriptor state is allocated from these pools, so adding and removing connections doesn't reach the global allocator.
+    // Declared first, the records in _monitoredFds and the connection buffers must be destroyed before them.
+    SlabPool _asyncIoPool{sizeof(AsyncIoState), alignof(AsyncIoState)};
+    SlabPool _connectionPool;
+    // Blocks for the connection buffers of the initial RingBuffer size, 64 KiB per slab
+    static constexpr size_t BUFFER_BLOCKS_PER_SLAB = 16;
+    SlabPool _bufferPool{RingBuffer::MIN_CAPACITY, alignof(std::max_align_t), BUFFER_BLOCKS_PER_SLAB};
+    DescriptorTable _monitoredFds{};
     const int _epollFd;
+    const EpollBackend _backend;
+    // Replaces the epoll fd with the io_uring backend, nullptr otherwise
+    std::unique_ptr<IoUringPoller> _ioUring = nullptr;
+    // Only read with EpollTriggerMode::RUNTIME, isEdgeTriggered() is a constant otherwise
     const int _isEdgeTriggered;
+    // Flags added to the events of every descriptor (EPOLLET in edge triggered mode), resolved once in the constructor
+    const uint32_t _triggerModeEvents;
 
-    const int _maxEventsNum = 10;
+    // Number of consecutive batches required before the batch size is changed
+    static constexpr int BATCH_ADAPT_WINDOW = 4;
+
+    const int _minBatchSize;
+    const int _maxBatchSize;
+    int _batchSize;
+    int _fullBatchesNum = 0;
+    int _sparseBatchesNum = 0;
     std::vector<epoll_event> _eventsVector{};
 
+    // Tasks passed to the loop thread by post()
+    using PostedTask = InplaceFunction<void(), 8 * sizeof(void *)>;
+    // Max number of posted tasks run per wakeup, so tasks posting other tasks can't starve the descriptors
+    static constexpr int MAX_POSTED_TASKS_NUM = 1024;
+
+    MpscQueue<PostedTask> _postedTasks{};
+    // Thread which runs the event loop, empty until waitForEvents() is called for the first time
+    std::atomic<std::thread::id> _loopThreadId{};
+    // Internal eventfd which wakes up the loop, it's registered directly with the kernel and isn't a part of _monitoredFds
+    int _wakeupFd = -1;
+    // Set while a wakeup is signalled and not yet consumed by the loop, further posts then skip the eventfd write
+    std::atomic<bool> _isWakeupPending{false};
+    // Set by stop(), consumed by the loop once it returns
+    std::atomic<bool> _isStopRequested{false};
+
+    TimerQueue _timers{};
+    std::atomic<TimerId> _nextTimerId{1};
+    // Cleared once epoll_pwait2() fails with ENOSYS or EPERM, the kernel is too old for it or a seccomp filter blocks it
+    bool _isPwait2Supported = true;
+
+    TimingWheel _timeouts{};
+
+    // Internal signalfd, created by the first addSignalHandler() call
+    int _signalFd = -1;
+    sigset_t _handledSignals{};
+    // Signals which were blocked by addSignalHandler() and have to be unblocked once they aren't handled anymore
+    sigset_t _blockedSignals{};
+    std::unordered_map<int, std::function<void(int)>> _signalHandlers{};
+
+    // Descriptors (fd and generation) whose pending async operations can run without waiting, because the fd is known to be ready
+    std::vector<std::pair<int, uint32_t>> _readyAsyncFds{};
+    std::vector<std::pair<int, uint32_t>> _runningAsyncFds{};
+
+    // Set while waitForEvents() calls handlers, records removed meanwhile are kept in _retiredDescriptors until the batch ends
+    bool _isDispatching = false;
+    std::vector<SlabPtr<typename DescriptorTable::value_type>> _retiredDescriptors{};
+
+    /**
+     * Waits for a batch of events until the deadline (or the next timer or timeout), then runs the timers, timeouts and handlers
+     */
+    void _waitForEvents(Clock::time_point deadline);
+
+    /**
+     * Checks if run() should continue, consumes a stop request
+     */
+    bool _keepRunning();
+
+    /**
+     * Time after the timeout counted from now, Clock::time_point::max() if it would overflow. Negative timeouts count as zero.
+     */
+    static Clock::time_point _getDeadline(std::chrono::nanoseconds timeout);
+
+    /**
+     * Calls the handlers of one event. The upper 32 bits of event.data.u64 hold the generation of the record the event belongs to.
+     */
+    void _dispatchEvent(const epoll_event &event);
+
+    /**
+     * Starts waiting for a single readiness (EPOLLIN or EPOLLOUT) of the fd, the handler is called with 0 once it occurs.
+     * It's an async operation without a buffer, the caller makes the syscalls itself.
+     */
+    void _awaitReadiness(int fd, uint32_t eventType, AsyncIoHandler handler);
+
+    /**
+     * Connection of the fd, nullptr if the fd isn't monitored or isn't a connection
+     */
+    Connection *_findConnection(int fd);
+
+    friend Connection;
+#ifdef EPOLL_CPP_COROUTINES
+    friend BasicReadinessAwaiter<Traits>;
+#endif
+
+    /**
+     * Performs the pending async operations of the descriptor which can make progress and calls the handlers of the completed ones
+     * @param events the events which occurred, 0 if the fd was taken from _readyAsyncFds
+     */
+    void _runAsyncIo(int fd, uint32_t generation, uint32_t events);
+
+    /**
+     * Runs the async operations of the descriptors in _readyAsyncFds
+     */
+    void _runReadyAsyncIo();
+
+    /**
+     * Finishes starting an async operation: queues the fd if it's known to be ready, or updates the kernel interest
+     * @param previousInterest async interest of the descriptor before the operation was added
+     */
+    void _startAsyncIo(MonitoredDescriptor &md, uint32_t previousInterest, bool isReady);
+
+    /**
+     * Returns the async state of the descriptor, creating it on the first use
+     */
+    AsyncIoState &_getAsyncIo(MonitoredDescriptor &md);
+
+    /**
+     * Event types the async operations of the descriptor need. In edge triggered mode both directions are always watched and
+     * the readiness is tracked by AsyncIoState, in level triggered mode only the directions with a pending operation are watched.
+     */
+    uint32_t _getAsyncInterest(const MonitoredDescriptor &md) const;
+
+    /**
+     * @return false if nothing could be read yet, the result is set otherwise
+     */
+    bool _performAsyncRead(int fd, AsyncIoState &io, ssize_t &result) const;
+
+    /**
+     * @return false if the write hasn't finished yet, the result is set otherwise
+     */
+    bool _performAsyncWrite(int fd, AsyncIoState &io, ssize_t &result) const;
+
+    /**
+     * Releases the records removed during the batch
+     */
+    void _finishBatch();
+
+    /**
+     * Handles an event of an internal descriptor (see DescriptorTable::INTERNAL_GENERATION)
+     */
+    void _dispatchInternalEvent(int fd);
+
+    void _runPostedTasks();
+
+    /**
+     * Reads all pending signals from the signalfd and calls their handlers
+     */
+    void _runSignalHandlers();
+
+    /**
+     * Makes the signalfd (creating it if needed) listen for _handledSignals
+     */
+    void _updateSignalFd();
+
+    /**
+     * Earliest deadline of the timers and the timing wheel, Clock::time_point::max() if there is none
+     */
+    Clock::time_point _getNextDeadline();
+
+    /**
+     * Waits for a batch of events until the deadline (Clock::time_point::max() waits indefinitely)
+     * @return number of events in _eventsVector, -1 on error
+     */
+    int _epollWait(Clock::time_point deadline);
+
+    /**
+     * Throws if the calling thread isn't the loop thread
+     */
+    void _checkLoopThread(const char *method) const;
+
+    void _post(PostedTask task);
+
+    /**
+     * Checks if the calling thread isn't the loop thread, registration changes from such thread must be deferred by _post()
+     */
+    bool _isForeignThread() const {
+        const std::thread::id loopThreadId = _loopThreadId.load(std::memory_order_acquire);
+        return loopThreadId != std::thread::id() && loopThreadId != std::this_thread::get_id();
+    }
+
+    /**
+     * Signals the wakeup eventfd unless a wakeup is already pending
+     */
+    void _wakeUp();
+
+    /**
+     * Grows the batch if the last few epoll_wait() calls filled it completely, shrinks it if they used less than a quarter of it.
+     */
+    void _adaptBatchSize(int numOfEvents);
+
     void _reloadEventHandlers(MonitoredDescriptor& md) const;
 
+    uint32_t _getTriggerModeEvents() const {
+        if constexpr (Traits::triggerMode == EpollTriggerMode::RUNTIME)
+            return _triggerModeEvents;
+        else
+            return Traits::triggerMode == EpollTriggerMode::EDGE ? uint32_t(EPOLLET) : 0u;
+    }
+
     /**
      * ADDS events to a NEW fd. If the FD is not new, _epollCtlModify must be used instead.
+     * @param token value returned by the kernel in epoll_event.data.u64
      */
-    void _epollCtlAdd(int fd, uint32_t events) const;
+    void _epollCtlAdd(int fd, uint32_t events, uint64_t token) const;
 
     /**
      * REWRITES the events of certain FD. All previously added events will be REMOVED.
      */
-    void _epollCtlModify(int fd, uint32_t events) const;
+    void _epollCtlModify(int fd, uint32_t events, uint64_t token) const;
 
     static void _setNonBlocking(int fd);
 
+    /**
+     * Throws if the descriptor is exclusive and eventTypes contain an event type which can't be combined with EPOLLEXCLUSIVE
+     */
+    static void _checkExclusiveEvents(const MonitoredDescriptor &md, uint32_t eventTypes);
+
     void _epollCtlDelete(int fd) const;
 
 public:
-    virtual ~Epoll();
+    virtual ~BasicEpoll();
 };
+
+extern template class BasicEpoll<DefaultEpollTraits>;
+extern template class BasicEpoll<LevelTriggeredEpollTraits>;
+extern template class BasicEpoll<EdgeTriggeredEpollTraits>;
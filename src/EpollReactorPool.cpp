@@ -0,0 +1,197 @@
+#include "EpollReactorPool.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdexcept>
+#include <string>
+
+EpollReactorPool::EpollReactorPool(size_t reactorsNum, bool isEdgeTriggered, ReactorAssignmentPolicy policy, bool pinThreads)
+        : _policy(policy), _pinThreads(pinThreads) {
+    if (reactorsNum == 0) {
+        throw std::runtime_error("EpollReactorPool::EpollReactorPool: ERROR - The pool needs at least one reactor.");
+    }
+
+    _reactors.reserve(reactorsNum);
+    for (size_t i = 0; i < reactorsNum; i++) {
+        _reactors.push_back(std::make_unique<Reactor>(isEdgeTriggered));
+    }
+}
+
+EpollReactorPool::~EpollReactorPool() {
+    // A destructor can't throw, the exception of a failed reactor is lost here
+    _join();
+}
+
+// # EpollReactorPool class public interface
+// ######################################################################################################################
+
+void EpollReactorPool::start() {
+    if (_isRunning) {
+        throw std::runtime_error("EpollReactorPool::start: ERROR - The pool is already running.");
+    }
+
+    _stopRequested.store(false);
+    _isRunning = true;
+
+    for (size_t i = 0; i < _reactors.size(); i++) {
+        Reactor &reactor = *_reactors[i];
+        reactor.thread = std::thread(&EpollReactorPool::_runReactor, this, i);
+
+        if (_pinThreads) {
+            try {
+                _pinThread(reactor.thread, i);
+            } catch (...) {
+                stop();
+                throw;
+            }
+        }
+    }
+}
+
+void EpollReactorPool::stop() {
+    if (std::exception_ptr error = _join()) {
+        std::rethrow_exception(error);
+    }
+}
+
+void EpollReactorPool::post(size_t reactorIndex, std::function<void(Epoll &)> task) {
+    Epoll &epoll = _reactors.at(reactorIndex)->epoll;
+    epoll.post([&epoll, task = std::move(task)] { task(epoll); });
+}
+
+size_t EpollReactorPool::addDescriptor(int fd, std::function<void(Epoll &, int)> registerHandlers) {
+    const size_t reactorIndex = selectReactor(fd);
+
+    post(reactorIndex, [fd, registerHandlers = std::move(registerHandlers)](Epoll &epoll) {
+        epoll.addDescriptor(fd);
+        if (registerHandlers) {
+            registerHandlers(epoll, fd);
+        }
+    });
+
+    return reactorIndex;
+}
+
+size_t EpollReactorPool::selectReactor(int fd) {
+    size_t reactorIndex = 0;
+
+    if (_customSelector) {
+        reactorIndex = _customSelector(fd) % _reactors.size();
+    } else {
+        switch (_policy) {
+            case ReactorAssignmentPolicy::ROUND_ROBIN:
+                reactorIndex = _nextReactor.fetch_add(1, std::memory_order_relaxed) % _reactors.size();
+                break;
+            case ReactorAssignmentPolicy::LEAST_LOADED:
+                for (size_t i = 1; i < _reactors.size(); i++) {
+                    if (_reactors[i]->load.load(std::memory_order_relaxed) < _reactors[reactorIndex]->load.load(std::memory_order_relaxed)) {
+                        reactorIndex = i;
+                    }
+                }
+                break;
+            case ReactorAssignmentPolicy::FD_HASH:
+                // Fibonacci hashing, the high bits of the product are mapped onto the reactors, so even regular fd patterns spread evenly
+                reactorIndex = (static_cast<uint64_t>(static_cast<uint32_t>(fd) * 2654435769u) * _reactors.size()) >> 32;
+                break;
+        }
+    }
+
+    // Count the descriptor right away, so a burst of new descriptors doesn't end up on the same least loaded reactor
+    _reactors[reactorIndex]->load.fetch_add(1, std::memory_order_relaxed);
+    return reactorIndex;
+}
+
+void EpollReactorPool::setCustomAssignmentPolicy(std::function<size_t(int)> selector) {
+    if (_isRunning) {
+        throw std::runtime_error("EpollReactorPool::setCustomAssignmentPolicy: ERROR - The policy can't be changed while the pool is running.");
+    }
+    _customSelector = std::move(selector);
+}
+
+void EpollReactorPool::setErrorHandler(std::function<void(size_t, std::exception_ptr)> errorHandler) {
+    if (_isRunning) {
+        throw std::runtime_error("EpollReactorPool::setErrorHandler: ERROR - The error handler can't be changed while the pool is running.");
+    }
+    _errorHandler = std::move(errorHandler);
+}
+
+// # EpollReactorPool class getters
+// ######################################################################################################################
+
+Epoll &EpollReactorPool::getReactor(size_t reactorIndex) {
+    return _reactors.at(reactorIndex)->epoll;
+}
+
+size_t EpollReactorPool::getLoad(size_t reactorIndex) const {
+    return _reactors.at(reactorIndex)->load.load(std::memory_order_relaxed);
+}
+
+size_t EpollReactorPool::size() const {
+    return _reactors.size();
+}
+
+bool EpollReactorPool::isRunning() const {
+    return _isRunning;
+}
+
+// # EpollReactorPool class private members
+// ######################################################################################################################
+
+void EpollReactorPool::_runReactor(size_t reactorIndex) {
+    Reactor &reactor = *_reactors[reactorIndex];
+
+    // Tasks posted before start() are already signalled, the first pass runs them
+    while (!_stopRequested.load(std::memory_order_acquire)) {
+        try {
+            reactor.epoll.waitForEvents();
+        } catch (...) {
+            // An exception leaving the thread function would terminate the whole process
+            if (!_errorHandler) {
+                reactor.error = std::current_exception();
+                return;
+            }
+            _errorHandler(reactorIndex, std::current_exception());
+        }
+        reactor.load.store(reactor.epoll.getMonitoredFds().size(), std::memory_order_relaxed);
+    }
+}
+
+std::exception_ptr EpollReactorPool::_join() {
+    if (!_isRunning)
+        return nullptr;
+
+    _stopRequested.store(true);
+    for (auto &reactor: _reactors) {
+        // An empty task is enough to wake up the loop
+        reactor->epoll.post([] {});
+    }
+
+    std::exception_ptr firstError = nullptr;
+    for (auto &reactor: _reactors) {
+        if (reactor->thread.joinable()) {
+            reactor->thread.join();
+        }
+        if (reactor->error != nullptr && firstError == nullptr) {
+            firstError = reactor->error;
+        }
+        reactor->error = nullptr;
+    }
+    _isRunning = false;
+    return firstError;
+}
+
+void EpollReactorPool::_pinThread(std::thread &thread, size_t cpuIndex) {
+    const unsigned int cpusNum = std::thread::hardware_concurrency();
+
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(cpusNum != 0 ? cpuIndex % cpusNum : 0, &cpuSet);
+
+    if (pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &cpuSet) != 0) {
+        throw std::runtime_error("EpollReactorPool::_pinThread: ERROR - Failed to pin reactor thread to CPU " + std::to_string(cpuIndex) + ".");
+    }
+}
+
+// # Reactor members
+// ######################################################################################################################
+
+EpollReactorPool::Reactor::Reactor(bool isEdgeTriggered) : epoll(isEdgeTriggered) {}
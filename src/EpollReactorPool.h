@@ -0,0 +1,130 @@
+#pragma once
+
+#include "Epoll.h"
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+/**
+ * Decides which reactor of EpollReactorPool receives a new descriptor
+ */
+enum class ReactorAssignmentPolicy {
+    ROUND_ROBIN,  // Reactors take turns
+    LEAST_LOADED, // Reactor which monitors the fewest descriptors
+    FD_HASH       // Reactor chosen by a hash of the fd number, the same fd number always lands on the same reactor
+};
+
+/**
+ * Owns N Epoll instances, each of them runs its own event loop on a dedicated thread.
+ * Descriptors are spread across the reactors by a ReactorAssignmentPolicy (or a custom selector function).
+ *
+ * An Epoll instance is single-threaded, so it must only be touched from its own reactor thread. Work for a reactor
+ * (adding descriptors and handlers) is therefore passed to it by post() or addDescriptor(), which can be called from any thread.
+ */
+class EpollReactorPool {
+public:
+    /**
+     * @param reactorsNum number of Epoll instances and threads
+     * @param isEdgeTriggered passed to every Epoll instance
+     * @param policy how addDescriptor() chooses the reactor
+     * @param pinThreads pin reactor thread i to CPU (i % number of CPUs)
+     */
+    EpollReactorPool(size_t reactorsNum, bool isEdgeTriggered, ReactorAssignmentPolicy policy = ReactorAssignmentPolicy::ROUND_ROBIN,
+                     bool pinThreads = false);
+
+    EpollReactorPool(const EpollReactorPool &) = delete;
+
+    EpollReactorPool &operator=(const EpollReactorPool &) = delete;
+
+    /**
+     * Starts the reactor threads. Tasks posted before start() are run once the threads are up.
+     */
+    void start();
+
+    /**
+     * Wakes up all reactors, waits until every thread finishes its current batch of events and joins them.
+     * Tasks which haven't run yet stay queued for the next start(). Must not be called from a reactor thread.
+     * Rethrows the first exception which stopped a reactor (see setErrorHandler()), after all threads are joined.
+     */
+    void stop();
+
+    /**
+     * Runs the task on the thread of this reactor. Thread safe.
+     */
+    void post(size_t reactorIndex, std::function<void(Epoll &)> task);
+
+    /**
+     * Chooses a reactor for fd by the assignment policy and registers the fd there. Thread safe.
+     * @param fd the file descriptor number
+     * @param registerHandlers called on the reactor thread right after Epoll::addDescriptor(), add the event handlers here
+     * @return index of the chosen reactor
+     */
+    size_t addDescriptor(int fd, std::function<void(Epoll &, int)> registerHandlers);
+
+    /**
+     * Returns the index of the reactor which the assignment policy chooses for this fd. Thread safe.
+     */
+    size_t selectReactor(int fd);
+
+    /**
+     * Replaces the assignment policy by a custom function returning the reactor index for a fd.
+     * Must be called before start(), the selector has to be thread safe if addDescriptor() is called from multiple threads.
+     */
+    void setCustomAssignmentPolicy(std::function<size_t(int)> selector);
+
+    /**
+     * Sets the function which receives the exceptions thrown by handlers and tasks on the reactor threads, the reactor then keeps running.
+     * The function is called on the reactor thread and must not throw. Without it, an exception stops its reactor (the others keep
+     * running) and stop() rethrows it. Must be called before start().
+     */
+    void setErrorHandler(std::function<void(size_t reactorIndex, std::exception_ptr error)> errorHandler);
+
+    /**
+     * The Epoll instance of this reactor. While the pool runs, use it only from the reactor's own thread (for example inside of a posted task).
+     */
+    Epoll &getReactor(size_t reactorIndex);
+
+    /**
+     * Approximate number of descriptors monitored by this reactor, updated after every event batch. Thread safe.
+     */
+    size_t getLoad(size_t reactorIndex) const;
+
+    size_t size() const;
+
+    bool isRunning() const;
+
+    ~EpollReactorPool();
+
+private:
+    struct Reactor {
+        explicit Reactor(bool isEdgeTriggered);
+
+        Epoll epoll;
+        std::thread thread{};
+        std::atomic<size_t> load{0};
+        // Exception which stopped the reactor thread, rethrown by stop()
+        std::exception_ptr error{};
+    };
+
+    std::vector<std::unique_ptr<Reactor>> _reactors{};
+    const ReactorAssignmentPolicy _policy;
+    std::function<size_t(int)> _customSelector = nullptr;
+    std::function<void(size_t, std::exception_ptr)> _errorHandler = nullptr;
+    const bool _pinThreads;
+    std::atomic<size_t> _nextReactor{0};
+    std::atomic<bool> _stopRequested{false};
+    bool _isRunning = false;
+
+    void _runReactor(size_t reactorIndex);
+
+    /**
+     * Wakes up and joins the reactor threads
+     * @return the first exception which stopped a reactor, if any
+     */
+    std::exception_ptr _join();
+
+    static void _pinThread(std::thread &thread, size_t cpuIndex);
+};
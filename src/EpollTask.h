@@ -0,0 +1,125 @@
+#pragma once
+
+// Coroutine support needs a C++20 build (the EPOLL_CPP_CXX20 CMake option), the header is empty otherwise
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#define EPOLL_CPP_COROUTINES 1
+
+#include <array>
+#include <coroutine>
+#include <cstddef>
+#include <new>
+
+/**
+ * Allocator of coroutine frames. Freed frames are kept in per-thread free lists of 64 byte size classes and reused
+ * by the next coroutine of a similar size, so a server which starts a coroutine per connection doesn't touch the global
+ * allocator once it warms up. Frames bigger than MAX_POOLED_SIZE are allocated by the global operator new.
+ * A frame can be freed on another thread than the one which allocated it, it then moves to the pool of that thread.
+ * The pooled frames of a thread are returned to the global allocator when the thread exits.
+ */
+class CoroutineFramePool {
+public:
+    static constexpr size_t GRANULARITY = 64;
+    static constexpr size_t MAX_POOLED_SIZE = 4096;
+
+    static void *allocate(size_t size) {
+        if (size > MAX_POOLED_SIZE)
+            return ::operator new(size);
+
+        const size_t sizeClass = _getSizeClass(size);
+        FreeBlock *&freeList = _freeLists.heads[sizeClass];
+        if (freeList != nullptr) {
+            FreeBlock *block = freeList;
+            freeList = block->next;
+            return block;
+        }
+        return ::operator new((sizeClass + 1) * GRANULARITY);
+    }
+
+    static void deallocate(void *pointer, size_t size) noexcept {
+        if (size > MAX_POOLED_SIZE) {
+            ::operator delete(pointer);
+            return;
+        }
+
+        FreeBlock *&freeList = _freeLists.heads[_getSizeClass(size)];
+        freeList = ::new(pointer) FreeBlock{freeList};
+    }
+
+private:
+    struct FreeBlock {
+        FreeBlock *next;
+    };
+
+    /**
+     * Free lists of one thread, they own the blocks
+     */
+    struct FreeLists {
+        std::array<FreeBlock *, MAX_POOLED_SIZE / GRANULARITY> heads;
+
+        // Not defaulted, a default member initializer can't be used by the static member below within the class
+        FreeLists() : heads{} {}
+
+        FreeLists(const FreeLists &) = delete;
+
+        FreeLists &operator=(const FreeLists &) = delete;
+
+        ~FreeLists() {
+            for (FreeBlock *block: heads) {
+                while (block != nullptr) {
+                    FreeBlock *next = block->next;
+                    ::operator delete(block);
+                    block = next;
+                }
+            }
+        }
+    };
+
+    static inline thread_local FreeLists _freeLists;
+
+    static size_t _getSizeClass(size_t size) {
+        return size == 0 ? 0 : (size - 1) / GRANULARITY;
+    }
+};
+
+/**
+ * Return type of coroutines which await Epoll::readable(), Epoll::writable() and Epoll::sleep().
+ * The coroutine starts right away and runs until its first co_await, then it's resumed directly by the event loop.
+ * Nobody awaits the task itself (fire and forget), its frame is freed once the coroutine finishes.
+ * An exception which escapes the coroutine is thrown out of the call which ran it, like an exception of an event handler:
+ * out of the coroutine call itself before the first co_await, out of the call which resumed it (usually waitForEvents())
+ * afterwards. The frame is freed in both cases.
+ */
+class EpollTask {
+public:
+    /**
+     * Resumes a coroutine suspended by one of the Epoll awaiters.
+     * The rethrow of unhandled_exception() leaves the coroutine suspended at its final suspend point, so the frame
+     * of a failed coroutine is destroyed here before the exception goes on.
+     */
+    static void resume(std::coroutine_handle<> handle) {
+        try {
+            handle.resume();
+        } catch (...) {
+            handle.destroy();
+            throw;
+        }
+    }
+
+    struct promise_type {
+        EpollTask get_return_object() noexcept { return {}; }
+
+        std::suspend_never initial_suspend() noexcept { return {}; }
+
+        std::suspend_never final_suspend() noexcept { return {}; }
+
+        void return_void() noexcept {}
+
+        void unhandled_exception() { throw; }
+
+        static void *operator new(size_t size) { return CoroutineFramePool::allocate(size); }
+
+        static void operator delete(void *pointer, size_t size) noexcept { CoroutineFramePool::deallocate(pointer, size); }
+    };
+};
+
+#endif
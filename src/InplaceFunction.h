@@ -0,0 +1,204 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+template<typename Signature, std::size_t Capacity = 2 * sizeof(void *)>
+class InplaceFunction;
+
+/**
+ * Move-only replacement of std::function which stores the callable inside of the object itself and never allocates memory.
+ * Callables bigger than Capacity bytes (for example lambdas with too many captures or a std::function) are rejected at compile time.
+ * Code which has to pass such callables can wrap them by allocate(), the only way to get a heap allocated callable.
+ * Trivially copyable callables (function pointers, lambdas capturing pointers, references or numbers) are moved with a plain copy.
+ * A plain function with a context pointer can be stored too, it's then called without constructing or moving any callable object.
+ */
+template<typename R, typename... Args, std::size_t Capacity>
+class InplaceFunction<R(Args...), Capacity> {
+public:
+    InplaceFunction() noexcept = default;
+
+    InplaceFunction(std::nullptr_t) noexcept {}
+
+    template<typename F, typename Functor = std::decay_t<F>,
+            typename = std::enable_if_t<!std::is_same_v<Functor, InplaceFunction> && std::is_invocable_r_v<R, Functor &, Args...>>>
+    InplaceFunction(F &&callable) {
+        static_assert(sizeof(Functor) <= Capacity, "InplaceFunction: ERROR - the callable doesn't fit into the inline storage, capture less "
+                                                   "data or wrap it by InplaceFunction::allocate().");
+        static_assert(alignof(Functor) <= alignof(void *), "InplaceFunction: ERROR - the callable is over-aligned for the inline storage.");
+        static_assert(std::is_nothrow_move_constructible_v<Functor>, "InplaceFunction: ERROR - the callable must be nothrow move constructible.");
+
+        if constexpr (std::is_pointer_v<std::remove_reference_t<F>> || std::is_member_pointer_v<std::remove_reference_t<F>>) {
+            if (callable == nullptr)
+                return;
+        }
+
+        // Checked again only to keep the compiler quiet after a failed static_assert
+        if constexpr (_isStoredInline<Functor>()) {
+            ::new(static_cast<void *>(_storage)) Functor(std::forward<F>(callable));
+            _invoke = &_invokeFunctor<Functor>;
+            if constexpr (!std::is_trivially_copyable_v<Functor> || !std::is_trivially_destructible_v<Functor>) {
+                _manage = &_manageFunctor<Functor>;
+            }
+        }
+    }
+
+    /**
+     * Stores a callable which doesn't fit into the inline storage (a std::function, a lambda with big captures) on the heap,
+     * only the pointer to it is kept inline. Unlike the constructors this allocates, meant for code ported from std::function
+     * and for handlers registered off the hot path.
+     */
+    template<typename F, typename Functor = std::decay_t<F>, typename = std::enable_if_t<std::is_invocable_r_v<R, Functor &, Args...>>>
+    static InplaceFunction allocate(F &&callable) {
+        static_assert(Capacity >= sizeof(Functor *), "InplaceFunction: ERROR - the capacity must hold a pointer.");
+
+        InplaceFunction function;
+        if constexpr (std::is_constructible_v<bool, const Functor &>) {
+            // An empty std::function or a null function pointer
+            if (!static_cast<bool>(callable))
+                return function;
+        }
+
+        // Only the pointer is kept in the storage, moving it never touches the callable
+        Functor *functor = new Functor(std::forward<F>(callable));
+        std::memcpy(function._storage, &functor, sizeof(functor));
+        function._invoke = &_invokeHeapFunctor<Functor>;
+        function._manage = &_manageHeapFunctor<Functor>;
+        return function;
+    }
+
+    /**
+     * Wraps a plain function and a context pointer which is passed to it as the last argument.
+     * Both are stored as two plain words, the invoker loads them and tail-calls the function, no callable object is involved.
+     */
+    InplaceFunction(R (*function)(Args..., void *), void *context) noexcept {
+        static_assert(Capacity >= sizeof(RawFunction), "InplaceFunction: the capacity must hold a function and a context pointer");
+        if (function == nullptr)
+            return;
+
+        ::new(static_cast<void *>(_storage)) RawFunction{function, context};
+        _invoke = &_invokeRawFunction;
+    }
+
+    InplaceFunction(InplaceFunction &&other) noexcept {
+        _moveFrom(other);
+    }
+
+    InplaceFunction &operator=(InplaceFunction &&other) noexcept {
+        if (this != &other) {
+            _reset();
+            _moveFrom(other);
+        }
+        return *this;
+    }
+
+    InplaceFunction &operator=(std::nullptr_t) noexcept {
+        _reset();
+        return *this;
+    }
+
+    InplaceFunction(const InplaceFunction &) = delete;
+
+    InplaceFunction &operator=(const InplaceFunction &) = delete;
+
+    ~InplaceFunction() {
+        _reset();
+    }
+
+    explicit operator bool() const noexcept { return _invoke != nullptr; }
+
+    bool operator==(std::nullptr_t) const noexcept { return _invoke == nullptr; }
+
+    bool operator!=(std::nullptr_t) const noexcept { return _invoke != nullptr; }
+
+    R operator()(Args... args) const {
+        return _invoke(std::forward<Args>(args)..., const_cast<unsigned char *>(_storage));
+    }
+
+private:
+    enum class Operation {
+        MOVE,
+        DESTROY
+    };
+
+    // Receives the call arguments followed by a pointer to the inline storage
+    using Invoker = R (*)(Args..., void *);
+    using Manager = void (*)(Operation, unsigned char *destination, unsigned char *source);
+
+    Invoker _invoke = nullptr;
+    // Null for trivially copyable callables, these are moved by copying the storage
+    Manager _manage = nullptr;
+    alignas(void *) unsigned char _storage[Capacity]{};
+
+    template<typename Functor>
+    static constexpr bool _isStoredInline() {
+        return sizeof(Functor) <= Capacity && alignof(Functor) <= alignof(void *) && std::is_nothrow_move_constructible_v<Functor>;
+    }
+
+    // A plain function with its context pointer, trivially copyable like the callables without a manager
+    struct RawFunction {
+        R (*function)(Args..., void *);
+        void *context;
+    };
+
+    template<typename Functor>
+    static R _invokeFunctor(Args... args, void *storage) {
+        return (*static_cast<Functor *>(storage))(std::forward<Args>(args)...);
+    }
+
+    template<typename Functor>
+    static R _invokeHeapFunctor(Args... args, void *storage) {
+        Functor *functor;
+        std::memcpy(&functor, storage, sizeof(functor));
+        return (*functor)(std::forward<Args>(args)...);
+    }
+
+    template<typename Functor>
+    static void _manageFunctor(Operation operation, unsigned char *destination, unsigned char *source) {
+        auto *functor = std::launder(reinterpret_cast<Functor *>(source));
+        if (operation == Operation::MOVE) {
+            ::new(static_cast<void *>(destination)) Functor(std::move(*functor));
+        }
+        functor->~Functor();
+    }
+
+    template<typename Functor>
+    static void _manageHeapFunctor(Operation operation, unsigned char *destination, unsigned char *source) {
+        if (operation == Operation::MOVE) {
+            std::memcpy(destination, source, sizeof(Functor *));
+            return;
+        }
+
+        Functor *functor;
+        std::memcpy(&functor, source, sizeof(functor));
+        delete functor;
+    }
+
+    static R _invokeRawFunction(Args... args, void *storage) {
+        const RawFunction &raw = *static_cast<const RawFunction *>(storage);
+        return raw.function(std::forward<Args>(args)..., raw.context);
+    }
+
+    void _moveFrom(InplaceFunction &other) noexcept {
+        if (other._manage != nullptr) {
+            other._manage(Operation::MOVE, _storage, other._storage);
+        } else {
+            std::memcpy(_storage, other._storage, Capacity);
+        }
+        _invoke = other._invoke;
+        _manage = other._manage;
+        other._invoke = nullptr;
+        other._manage = nullptr;
+    }
+
+    void _reset() noexcept {
+        if (_manage != nullptr) {
+            _manage(Operation::DESTROY, nullptr, _storage);
+        }
+        _invoke = nullptr;
+        _manage = nullptr;
+    }
+};
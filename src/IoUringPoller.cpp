@@ -0,0 +1,330 @@
+#include "IoUringPoller.h"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+IoUringPoller::IoUringPoller(unsigned completionsNum, bool isEdgeTriggered) : _isEdgeTriggered(isEdgeTriggered) {
+    io_uring_params params{};
+    params.flags = IORING_SETUP_CQSIZE;
+    // The kernel rejects a completion queue smaller than the submission queue
+    params.cq_entries = std::max(completionsNum, SUBMISSIONS_NUM);
+
+    _ringFd = int(syscall(__NR_io_uring_setup, SUBMISSIONS_NUM, &params));
+    if (_ringFd == -1) {
+        throw std::runtime_error("IoUringPoller::IoUringPoller: ERROR - Failed to create io_uring instance.");
+    }
+
+    // Timeouts of io_uring_enter() need IORING_ENTER_EXT_ARG, completions must not be dropped when the queue overflows
+    if ((params.features & IORING_FEAT_EXT_ARG) == 0 || (params.features & IORING_FEAT_NODROP) == 0) {
+        close(_ringFd);
+        throw std::runtime_error("IoUringPoller::IoUringPoller: ERROR - The kernel is too old for the io_uring backend (Linux 5.11+ is needed).");
+    }
+
+    _sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    _cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool isSingleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (isSingleMmap) {
+        _sqRingSize = _cqRingSize = std::max(_sqRingSize, _cqRingSize);
+    }
+    _sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+
+    _sqRing = mmap(nullptr, _sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ringFd, IORING_OFF_SQ_RING);
+    if (_sqRing != MAP_FAILED) {
+        _cqRing = isSingleMmap ? _sqRing : mmap(nullptr, _cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ringFd, IORING_OFF_CQ_RING);
+    }
+    if (_sqRing != MAP_FAILED && _cqRing != MAP_FAILED) {
+        _sqes = static_cast<io_uring_sqe *>(mmap(nullptr, _sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ringFd, IORING_OFF_SQES));
+    }
+    if (_sqRing == MAP_FAILED || _cqRing == MAP_FAILED || _sqes == MAP_FAILED) {
+        _unmapRings();
+        close(_ringFd);
+        throw std::runtime_error("IoUringPoller::IoUringPoller: ERROR - Failed to map io_uring queues.");
+    }
+
+    auto *sqRing = static_cast<char *>(_sqRing);
+    _sqHead = reinterpret_cast<unsigned *>(sqRing + params.sq_off.head);
+    _sqTail = reinterpret_cast<unsigned *>(sqRing + params.sq_off.tail);
+    _sqArray = reinterpret_cast<unsigned *>(sqRing + params.sq_off.array);
+    _sqMask = *reinterpret_cast<unsigned *>(sqRing + params.sq_off.ring_mask);
+    _sqEntries = params.sq_entries;
+
+    auto *cqRing = static_cast<char *>(_cqRing);
+    _cqHead = reinterpret_cast<unsigned *>(cqRing + params.cq_off.head);
+    _cqTail = reinterpret_cast<unsigned *>(cqRing + params.cq_off.tail);
+    _cqes = reinterpret_cast<io_uring_cqe *>(cqRing + params.cq_off.cqes);
+    _cqMask = *reinterpret_cast<unsigned *>(cqRing + params.cq_off.ring_mask);
+
+    // No feature flag tells about multishot polls (Linux 5.13), older kernels reject every edge triggered poll request
+    if (isEdgeTriggered && !_isMultishotPollSupported()) {
+        _unmapRings();
+        close(_ringFd);
+        throw std::runtime_error("IoUringPoller::IoUringPoller: ERROR - The kernel is too old for the edge triggered io_uring backend "
+                                 "(Linux 5.13+ is needed).");
+    }
+}
+
+IoUringPoller::~IoUringPoller() {
+    // Closing the ring cancels all poll requests
+    _unmapRings();
+    close(_ringFd);
+}
+
+// # IoUringPoller class public interface
+// ######################################################################################################################
+
+void IoUringPoller::add(int fd, uint32_t events, uint64_t token) {
+    if (fd < 0) {
+        throw std::runtime_error("IoUringPoller::add: ERROR - Invalid file descriptor.");
+    }
+
+    if (static_cast<size_t>(fd) >= _registrations.size()) {
+        _registrations.resize(std::max({static_cast<size_t>(fd) + 1, _registrations.size() * 2, size_t(64)}));
+    }
+
+    Registration &registration = _registrations[fd];
+    if (registration.isActive) {
+        throw std::runtime_error("IoUringPoller::add: ERROR - The file descriptor is already polled.");
+    }
+
+    registration = Registration{events, token, 0, true, false};
+    _submitPollAdd(fd, registration);
+}
+
+void IoUringPoller::modify(int fd, uint32_t events, uint64_t token) {
+    Registration *registration = _findRegistration(fd);
+    if (registration == nullptr) {
+        throw std::runtime_error("IoUringPoller::modify: ERROR - The file descriptor isn't polled.");
+    }
+
+    // The request is replaced instead of updated by IORING_POLL_UPDATE_EVENTS, a one-shot poll may have already ended
+    _submitPollRemove(registration->requestId);
+    registration->events = events;
+    registration->token = token;
+    registration->isPollEnded = false;
+    _submitPollAdd(fd, *registration);
+}
+
+void IoUringPoller::remove(int fd) {
+    Registration *registration = _findRegistration(fd);
+    if (registration == nullptr)
+        return;
+
+    _submitPollRemove(registration->requestId);
+    registration->isActive = false;
+    _isRemovalQueued = true;
+}
+
+void IoUringPoller::submitRemovals() {
+    if (!_isRemovalQueued)
+        return;
+
+    _submitPending();
+}
+
+int IoUringPoller::wait(epoll_event *events, int maxEvents, Clock::time_point deadline) {
+    // The handlers of the previous batch have run, polls ended by it can be started again without reporting the handled readiness twice
+    for (const int fd: _endedPolls) {
+        Registration *registration = _findRegistration(fd);
+        if (registration != nullptr && registration->isPollEnded) {
+            registration->isPollEnded = false;
+            _submitPollAdd(fd, *registration);
+        }
+    }
+    _endedPolls.clear();
+
+    // Everything queued is submitted below, removals included
+    _isRemovalQueued = false;
+
+    int numOfEvents = _reapCompletions(events, maxEvents);
+    if (numOfEvents > 0) {
+        // The events are returned right away, only the queued changes (if any) have to reach the kernel
+        const unsigned pendingSubmissions = _getPendingSubmissions();
+        if (pendingSubmissions != 0 && _enter(pendingSubmissions, 0, 0, nullptr, 0) == -1)
+            return -1;
+        return numOfEvents;
+    }
+
+    struct __kernel_timespec timeout{};
+    io_uring_getevents_arg arg{};
+    arg.sigmask_sz = _NSIG / 8;
+    if (deadline != Clock::time_point::max()) {
+        const auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - Clock::now()).count();
+        const auto remainingNs = std::max<decltype(remaining)>(remaining, 0);
+        timeout.tv_sec = remainingNs / 1000000000;
+        timeout.tv_nsec = remainingNs % 1000000000;
+        arg.ts = reinterpret_cast<uint64_t>(&timeout);
+    }
+
+    // Submits the queued changes and waits in a single syscall
+    if (_enter(_getPendingSubmissions(), 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg)) == -1 && errno != ETIME)
+        return -1;
+
+    return _reapCompletions(events, maxEvents);
+}
+
+int IoUringPoller::getRingFd() const {
+    return _ringFd;
+}
+
+// # IoUringPoller class private members
+// ######################################################################################################################
+
+IoUringPoller::Registration *IoUringPoller::_findRegistration(int fd) {
+    if (static_cast<size_t>(fd) >= _registrations.size() || !_registrations[fd].isActive)
+        return nullptr;
+    return &_registrations[fd];
+}
+
+io_uring_sqe &IoUringPoller::_getSqe() {
+    if (_getPendingSubmissions() == _sqEntries) {
+        _submitPending();
+    }
+
+    // Without SQPOLL the kernel reads the entries only during io_uring_enter() called by this thread, the tail can be moved first
+    const unsigned tail = *_sqTail;
+    const unsigned index = tail & _sqMask;
+    _sqArray[index] = index;
+    __atomic_store_n(_sqTail, tail + 1, __ATOMIC_RELEASE);
+
+    io_uring_sqe &sqe = _sqes[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    return sqe;
+}
+
+unsigned IoUringPoller::_getPendingSubmissions() const {
+    return *_sqTail - __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE);
+}
+
+void IoUringPoller::_submitPollAdd(int fd, Registration &registration) {
+    registration.requestId = (uint64_t(_nextRequestSequence++) << 32) | static_cast<uint32_t>(fd);
+
+    io_uring_sqe &sqe = _getSqe();
+    sqe.opcode = IORING_OP_POLL_ADD;
+    sqe.fd = fd;
+    sqe.poll32_events = registration.events & ~uint32_t(EPOLLET);
+    // A multishot poll is edge triggered, a one-shot poll checks the readiness again every time it's started
+    sqe.len = _isEdgeTriggered ? IORING_POLL_ADD_MULTI : 0;
+    sqe.user_data = registration.requestId;
+}
+
+void IoUringPoller::_submitPollRemove(uint64_t requestId) {
+    io_uring_sqe &sqe = _getSqe();
+    sqe.opcode = IORING_OP_POLL_REMOVE;
+    sqe.fd = -1;
+    sqe.addr = requestId;
+    sqe.user_data = REMOVE_USER_DATA;
+}
+
+void IoUringPoller::_submitPending() {
+    const unsigned pendingSubmissions = _getPendingSubmissions();
+    if (pendingSubmissions != 0 && _enter(pendingSubmissions, 0, 0, nullptr, 0) == -1) {
+        throw std::runtime_error("IoUringPoller::_submitPending: ERROR - Failed to submit io_uring requests.");
+    }
+}
+
+int IoUringPoller::_reapCompletions(epoll_event *events, int maxEvents) {
+    unsigned head = *_cqHead;
+    const unsigned tail = __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE);
+
+    int numOfEvents = 0;
+    while (head != tail && numOfEvents < maxEvents) {
+        const io_uring_cqe &cqe = _cqes[head & _cqMask];
+        head++;
+
+        if (cqe.user_data == REMOVE_USER_DATA)
+            continue;
+
+        // Completions of a replaced or removed request can still arrive, possibly after the fd number was reused. They are dropped,
+        // the current request checks the readiness again by itself.
+        const int fd = static_cast<int>(static_cast<uint32_t>(cqe.user_data));
+        Registration *registration = _findRegistration(fd);
+        if (registration == nullptr || registration->requestId != cqe.user_data)
+            continue;
+
+        if (cqe.res < 0) {
+            // A cancelled request was replaced or removed on purpose, any other error means the kernel rejected the poll
+            if (cqe.res != -ECANCELED) {
+                registration->isActive = false;
+            }
+            continue;
+        }
+
+        // io_uring always reports EPOLLRDHUP, epoll only if it was asked for
+        const uint32_t reportedEvents = registration->events | EPOLLERR | EPOLLHUP;
+        if ((static_cast<uint32_t>(cqe.res) & reportedEvents) != 0) {
+            events[numOfEvents].events = static_cast<uint32_t>(cqe.res) & reportedEvents;
+            events[numOfEvents].data.u64 = registration->token;
+            numOfEvents++;
+        }
+
+        // Every one-shot poll ends here, the kernel can end a multishot one too (for example when the completion queue overflowed)
+        if ((cqe.flags & IORING_CQE_F_MORE) == 0 && !registration->isPollEnded) {
+            registration->isPollEnded = true;
+            _endedPolls.push_back(fd);
+        }
+    }
+
+    __atomic_store_n(_cqHead, head, __ATOMIC_RELEASE);
+    return numOfEvents;
+}
+
+bool IoUringPoller::_isMultishotPollSupported() {
+    // An eventfd is always writable, its poll completes right away
+    const int probeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (probeFd == -1)
+        return false;
+
+    io_uring_sqe &sqe = _getSqe();
+    sqe.opcode = IORING_OP_POLL_ADD;
+    sqe.fd = probeFd;
+    sqe.poll32_events = EPOLLOUT;
+    sqe.len = IORING_POLL_ADD_MULTI;
+    sqe.user_data = PROBE_USER_DATA;
+
+    bool isSupported = false;
+    int result;
+    do {
+        result = _enter(_getPendingSubmissions(), 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+    } while (result == -1 && errno == EINTR);
+
+    if (result != -1) {
+        const unsigned head = *_cqHead;
+        const io_uring_cqe &cqe = _cqes[head & _cqMask];
+        isSupported = cqe.user_data == PROBE_USER_DATA && cqe.res >= 0;
+        __atomic_store_n(_cqHead, head + 1, __ATOMIC_RELEASE);
+
+        // The multishot poll stays armed, its cancellation completes it
+        if ((cqe.flags & IORING_CQE_F_MORE) != 0) {
+            _submitPollRemove(PROBE_USER_DATA);
+            do {
+                result = _enter(_getPendingSubmissions(), 2, IORING_ENTER_GETEVENTS, nullptr, 0);
+            } while (result == -1 && errno == EINTR);
+            __atomic_store_n(_cqHead, __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+        }
+    }
+
+    close(probeFd);
+    return isSupported && result != -1;
+}
+
+int IoUringPoller::_enter(unsigned toSubmit, unsigned minComplete, unsigned flags, void *arg, size_t argSize) {
+    return int(syscall(__NR_io_uring_enter, _ringFd, toSubmit, minComplete, flags, arg, argSize));
+}
+
+void IoUringPoller::_unmapRings() {
+    if (_sqes != nullptr && _sqes != MAP_FAILED) {
+        munmap(_sqes, _sqesSize);
+    }
+    if (_cqRing != nullptr && _cqRing != MAP_FAILED && _cqRing != _sqRing) {
+        munmap(_cqRing, _cqRingSize);
+    }
+    if (_sqRing != nullptr && _sqRing != MAP_FAILED) {
+        munmap(_sqRing, _sqRingSize);
+    }
+}
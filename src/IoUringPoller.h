@@ -0,0 +1,160 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <linux/io_uring.h>
+#include <sys/epoll.h>
+#include <vector>
+
+/**
+ * Readiness notifications through io_uring instead of epoll_ctl() and epoll_wait(), used by Epoll with EpollBackend::IO_URING.
+ * Talks to the kernel directly by the io_uring syscalls and the mmapped rings, liburing isn't needed.
+ * Every registered fd has one IORING_OP_POLL_ADD request. Its user_data is the fd with a sequence number which is unique for every
+ * request, so a completion of a replaced or removed request (even of an fd number which was reused since) is recognized and dropped.
+ * Completions of the current requests are turned into epoll_event records holding the event token of Epoll, so Epoll dispatches
+ * them exactly like the events returned by epoll_wait().
+ * In edge triggered mode the request is multishot. In level triggered mode it's one-shot and started again by the next wait(),
+ * after the handlers ran, so a descriptor which is still ready is reported again, just like by a level triggered epoll.
+ * Registration changes are only queued as submission entries and go to the kernel with the next wait(), a whole batch of changes
+ * made by the handlers costs no extra syscall. Because of that, a poll request which the kernel rejects (for example the fd was
+ * already closed) is silently dropped instead of throwing like epoll_ctl() would. Removals are the exception, a poll request keeps
+ * its file open, so Epoll submits them by submitRemovals() once the handlers ran instead of leaving them for the next wait().
+ * Not thread safe, Epoll uses it only from the loop thread.
+ */
+class IoUringPoller {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @param completionsNum minimal size of the completion queue, should hold a few batches of events
+     * @param isEdgeTriggered use multishot polls, otherwise one-shot polls are restarted after every event
+     * @throws std::runtime_error if the kernel is too old: Linux 5.11 is needed, 5.13 for the multishot polls of edge triggered mode
+     */
+    IoUringPoller(unsigned completionsNum, bool isEdgeTriggered);
+
+    // The instance owns the ring fd and its mappings, it can't be copied
+    IoUringPoller(const IoUringPoller &) = delete;
+
+    IoUringPoller &operator=(const IoUringPoller &) = delete;
+
+    ~IoUringPoller();
+
+    /**
+     * Starts polling the fd, the same as EPOLL_CTL_ADD. EPOLLET in events is ignored, the trigger mode is set by the constructor.
+     * @param token returned in epoll_event.data.u64 with every event of the fd
+     */
+    void add(int fd, uint32_t events, uint64_t token);
+
+    /**
+     * Replaces the events and the token of a polled fd, the same as EPOLL_CTL_MOD
+     */
+    void modify(int fd, uint32_t events, uint64_t token);
+
+    /**
+     * Stops polling the fd, does nothing if the fd isn't polled. The removal is only queued, see submitRemovals().
+     */
+    void remove(int fd);
+
+    /**
+     * Submits the queued requests if there is a removal among them. Until then, the kernel keeps the removed fds open
+     * (a socket closed by the application isn't released) and their poll requests can still complete.
+     */
+    void submitRemovals();
+
+    /**
+     * Submits the queued registration changes and waits until some events occur or the deadline passes.
+     * Completions which are already in the ring are returned without any syscall.
+     * @param deadline Clock::time_point::max() waits indefinitely
+     * @return number of events written to the buffer, 0 on timeout, -1 on error (errno is set, EINTR for example)
+     */
+    int wait(epoll_event *events, int maxEvents, Clock::time_point deadline);
+
+    int getRingFd() const;
+
+private:
+    // Entries of the submission queue, registration changes beyond that are submitted right away
+    static constexpr unsigned SUBMISSIONS_NUM = 256;
+    // user_data of POLL_REMOVE requests, no request id can have this value (its lower half would be fd -1)
+    static constexpr uint64_t REMOVE_USER_DATA = UINT64_MAX;
+    // user_data of the poll request made by _isMultishotPollSupported(), its lower half would be fd -2
+    static constexpr uint64_t PROBE_USER_DATA = UINT64_MAX - 1;
+
+    struct Registration {
+        uint32_t events = 0;
+        uint64_t token = 0;
+        // user_data of the current poll request of the fd
+        uint64_t requestId = 0;
+        bool isActive = false;
+        // The poll request completed and waits in _endedPolls to be started again
+        bool isPollEnded = false;
+    };
+
+    const bool _isEdgeTriggered;
+    int _ringFd = -1;
+
+    void *_sqRing = nullptr;
+    size_t _sqRingSize = 0;
+    void *_cqRing = nullptr;
+    size_t _cqRingSize = 0;
+    io_uring_sqe *_sqes = nullptr;
+    size_t _sqesSize = 0;
+
+    unsigned *_sqHead = nullptr;
+    unsigned *_sqTail = nullptr;
+    unsigned *_sqArray = nullptr;
+    unsigned _sqMask = 0;
+    unsigned _sqEntries = 0;
+
+    unsigned *_cqHead = nullptr;
+    unsigned *_cqTail = nullptr;
+    io_uring_cqe *_cqes = nullptr;
+    unsigned _cqMask = 0;
+
+    // Indexed by the fd number, like DescriptorTable
+    std::vector<Registration> _registrations{};
+    // Upper half of the next request id, the lower half is the fd
+    uint32_t _nextRequestSequence = 0;
+    // A POLL_REMOVE is queued and not submitted yet
+    bool _isRemovalQueued = false;
+    // Fds whose poll ended during the last wait(), their polls are started again by the next one
+    std::vector<int> _endedPolls{};
+
+    Registration *_findRegistration(int fd);
+
+    /**
+     * Returns a zeroed submission entry, submits the queued ones first if the queue is full
+     */
+    io_uring_sqe &_getSqe();
+
+    /**
+     * Number of submission entries which the kernel hasn't consumed yet
+     */
+    unsigned _getPendingSubmissions() const;
+
+    /**
+     * Queues a new poll request of the registration, gives it a new request id
+     */
+    void _submitPollAdd(int fd, Registration &registration);
+
+    void _submitPollRemove(uint64_t requestId);
+
+    /**
+     * Submits all queued requests without waiting
+     */
+    void _submitPending();
+
+    /**
+     * Moves completions from the ring to the buffer, remembers the polls which ended
+     */
+    int _reapCompletions(epoll_event *events, int maxEvents);
+
+    /**
+     * Polls an eventfd with a multishot request, kernels before 5.13 reject it. Used by the constructor, the ring is left empty.
+     */
+    bool _isMultishotPollSupported();
+
+    int _enter(unsigned toSubmit, unsigned minComplete, unsigned flags, void *arg, size_t argSize);
+
+    void _unmapRings();
+};
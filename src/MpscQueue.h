@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+/**
+ * Unbounded lock-free multi-producer single-consumer queue (intrusive linked list with a stub node, D. Vyukov's algorithm).
+ * push() can be called from any thread, it's a single atomic exchange. tryPop() must only be called from the consumer thread.
+ * A push which is still in progress can be invisible to tryPop() for a moment, the producer has to notify the consumer after push().
+ */
+template<typename T>
+class MpscQueue {
+public:
+    MpscQueue() : _head(new Node()), _tail(_head.load(std::memory_order_relaxed)) {}
+
+    MpscQueue(const MpscQueue &) = delete;
+
+    MpscQueue &operator=(const MpscQueue &) = delete;
+
+    void push(T value) {
+        Node *node = new Node(std::move(value));
+        Node *previous = _head.exchange(node, std::memory_order_acq_rel);
+        previous->next.store(node, std::memory_order_release);
+    }
+
+    /**
+     * Moves the oldest value into result
+     * @return false if the queue is empty
+     */
+    bool tryPop(T &result) {
+        Node *next = _tail->next.load(std::memory_order_acquire);
+        if (next == nullptr)
+            return false;
+
+        // The popped node becomes the new stub
+        result = std::move(next->value);
+        delete _tail;
+        _tail = next;
+        return true;
+    }
+
+    /**
+     * Checks if there is something to pop. Consumer thread only.
+     */
+    bool isEmpty() const {
+        return _tail->next.load(std::memory_order_acquire) == nullptr;
+    }
+
+    ~MpscQueue() {
+        while (_tail != nullptr) {
+            Node *next = _tail->next.load(std::memory_order_relaxed);
+            delete _tail;
+            _tail = next;
+        }
+    }
+
+private:
+    struct Node {
+        Node() = default;
+
+        explicit Node(T &&value) : value(std::move(value)) {}
+
+        std::atomic<Node *> next{nullptr};
+        T value{};
+    };
+
+    // Producers and the consumer work on different ends, keep them on separate cache lines
+    alignas(64) std::atomic<Node *> _head;
+    alignas(64) Node *_tail;
+};
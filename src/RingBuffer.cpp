@@ -0,0 +1,148 @@
+#include "RingBuffer.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+RingBuffer::RingBuffer(SlabPool *pool) : _pool(pool) {
+    if (pool != nullptr && pool->getBlockSize() < MIN_CAPACITY) {
+        throw std::runtime_error("RingBuffer::RingBuffer: ERROR - The blocks of the pool must hold MIN_CAPACITY bytes.");
+    }
+}
+
+RingBuffer::~RingBuffer() {
+    _releaseStorage(_buffer, _capacity);
+}
+
+// # RingBuffer class public interface
+// ######################################################################################################################
+
+void RingBuffer::append(const void *data, size_t size) {
+    if (size == 0)
+        return;
+
+    reserve(size);
+
+    const char *source = static_cast<const char *>(data);
+    const size_t tail = _getTail();
+    const size_t firstPart = std::min(size, _capacity - tail);
+    std::memcpy(_buffer + tail, source, firstPart);
+    std::memcpy(_buffer, source + firstPart, size - firstPart);
+    _size += size;
+}
+
+size_t RingBuffer::peek(void *output, size_t size) const {
+    size = std::min(size, _size);
+    if (size == 0)
+        return 0;
+
+    char *destination = static_cast<char *>(output);
+    const size_t firstPart = std::min(size, _capacity - _head);
+    std::memcpy(destination, _buffer + _head, firstPart);
+    std::memcpy(destination + firstPart, _buffer, size - firstPart);
+    return size;
+}
+
+size_t RingBuffer::read(void *output, size_t size) {
+    size = peek(output, size);
+    consume(size);
+    return size;
+}
+
+void RingBuffer::consume(size_t size) {
+    if (size >= _size) {
+        clear();
+        return;
+    }
+
+    _head = (_head + size) & (_capacity - 1);
+    _size -= size;
+}
+
+void RingBuffer::clear() {
+    // An empty queue starts at the beginning again, so that the next data doesn't wrap around needlessly
+    _head = 0;
+    _size = 0;
+}
+
+std::string_view RingBuffer::getReadableSpan() const {
+    return {_buffer + _head, std::min(_size, _capacity - _head)};
+}
+
+std::string_view RingBuffer::linearize() {
+    if (_head + _size > _capacity) {
+        std::rotate(_buffer, _buffer + _head, _buffer + _capacity);
+        _head = 0;
+    }
+    return getReadableSpan();
+}
+
+void RingBuffer::reserve(size_t freeSize) {
+    if (freeSize <= getFreeSize())
+        return;
+
+    size_t newCapacity = std::max(_capacity, MIN_CAPACITY);
+    while (newCapacity - _size < freeSize) {
+        newCapacity *= 2;
+    }
+
+    // The data moves to the start of the new storage
+    char *newBuffer = _allocateStorage(newCapacity);
+    peek(newBuffer, _size);
+    _releaseStorage(_buffer, _capacity);
+    _buffer = newBuffer;
+    _capacity = newCapacity;
+    _head = 0;
+}
+
+int RingBuffer::getReadableSpans(iovec (&spans)[2]) const {
+    if (_size == 0)
+        return 0;
+
+    const size_t firstPart = std::min(_size, _capacity - _head);
+    spans[0] = {_buffer + _head, firstPart};
+    if (firstPart == _size)
+        return 1;
+
+    spans[1] = {_buffer, _size - firstPart};
+    return 2;
+}
+
+int RingBuffer::getWritableSpans(iovec (&spans)[2]) {
+    const size_t freeSize = getFreeSize();
+    if (freeSize == 0)
+        return 0;
+
+    const size_t tail = _getTail();
+    const size_t firstPart = std::min(freeSize, _capacity - tail);
+    spans[0] = {_buffer + tail, firstPart};
+    if (firstPart == freeSize)
+        return 1;
+
+    spans[1] = {_buffer, freeSize - firstPart};
+    return 2;
+}
+
+void RingBuffer::commit(size_t size) {
+    _size += std::min(size, getFreeSize());
+}
+
+// # RingBuffer class private members
+// ######################################################################################################################
+
+char *RingBuffer::_allocateStorage(size_t capacity) {
+    if (_pool != nullptr && capacity == MIN_CAPACITY)
+        return static_cast<char *>(_pool->allocate());
+
+    return new char[capacity];
+}
+
+void RingBuffer::_releaseStorage(char *storage, size_t capacity) {
+    if (storage == nullptr)
+        return;
+
+    if (_pool != nullptr && capacity == MIN_CAPACITY) {
+        _pool->deallocate(storage);
+    } else {
+        delete[] storage;
+    }
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "SlabPool.h"
+#include <cstddef>
+#include <string_view>
+#include <sys/uio.h>
+
+/**
+ * Growable byte queue stored in a circular buffer, used by Connection for its input and output.
+ * Consuming data never moves the rest of it, the buffer grows (to a power of two) only when appended data doesn't fit.
+ * The data and the free space can wrap around the end of the storage, getReadableSpans() and getWritableSpans() describe
+ * both parts for scatter/gather syscalls like readv() and writev().
+ * Not thread safe.
+ */
+class RingBuffer {
+public:
+    static constexpr size_t MIN_CAPACITY = 4096;
+
+    /**
+     * @param pool optional pool of MIN_CAPACITY byte blocks, the storage of that size is taken from it instead of the heap.
+     *             It must outlive the buffer.
+     */
+    explicit RingBuffer(SlabPool *pool = nullptr);
+
+    RingBuffer(const RingBuffer &) = delete;
+
+    RingBuffer &operator=(const RingBuffer &) = delete;
+
+    ~RingBuffer();
+
+    /**
+     * Number of stored bytes
+     */
+    size_t size() const { return _size; }
+
+    bool empty() const { return _size == 0; }
+
+    size_t capacity() const { return _capacity; }
+
+    /**
+     * Number of bytes which can be appended without growing the buffer
+     */
+    size_t getFreeSize() const { return _capacity - _size; }
+
+    /**
+     * Copies the data to the end of the queue, grows the buffer if needed
+     */
+    void append(const void *data, size_t size);
+
+    /**
+     * Copies up to size bytes from the front of the queue without removing them
+     * @return number of copied bytes
+     */
+    size_t peek(void *output, size_t size) const;
+
+    /**
+     * Copies up to size bytes from the front of the queue and removes them
+     * @return number of copied bytes
+     */
+    size_t read(void *output, size_t size);
+
+    /**
+     * Removes up to size bytes from the front of the queue
+     */
+    void consume(size_t size);
+
+    void clear();
+
+    /**
+     * Contiguous part of the data at the front of the queue, it's all of the data unless the data wraps around
+     */
+    std::string_view getReadableSpan() const;
+
+    /**
+     * Moves the data to the start of the storage if it wraps around, so that all of it is contiguous
+     */
+    std::string_view linearize();
+
+    /**
+     * Grows the buffer so that at least freeSize bytes can be appended
+     */
+    void reserve(size_t freeSize);
+
+    /**
+     * Fills the vectors with the data (one or two parts), for writev() and similar syscalls
+     * @return number of used vectors, 0 if the queue is empty
+     */
+    int getReadableSpans(iovec (&spans)[2]) const;
+
+    /**
+     * Fills the vectors with the free space (one or two parts), for readv() and similar syscalls. Call commit() afterwards.
+     * @return number of used vectors, 0 if the buffer is full
+     */
+    int getWritableSpans(iovec (&spans)[2]);
+
+    /**
+     * Appends size bytes which were written into the spans returned by getWritableSpans()
+     */
+    void commit(size_t size);
+
+private:
+    SlabPool *const _pool;
+    char *_buffer = nullptr;
+    // Always a power of two (or zero), positions are masked by _capacity - 1
+    size_t _capacity = 0;
+    size_t _head = 0;
+    size_t _size = 0;
+
+    size_t _getTail() const { return (_head + _size) & (_capacity - 1); }
+
+    char *_allocateStorage(size_t capacity);
+
+    void _releaseStorage(char *storage, size_t capacity);
+};
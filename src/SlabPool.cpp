@@ -0,0 +1,68 @@
+#include "SlabPool.h"
+#include <algorithm>
+#include <stdexcept>
+
+SlabPool::SlabPool(size_t blockSize, size_t alignment, size_t blocksPerSlab)
+        : _blockSize(_getBlockSize(blockSize, alignment)), _alignment(std::max(alignment, alignof(FreeBlock))),
+          _blocksPerSlab(blocksPerSlab) {
+    if (blocksPerSlab == 0) {
+        throw std::runtime_error("SlabPool::SlabPool: ERROR - A slab must hold at least one block.");
+    }
+}
+
+SlabPool::~SlabPool() {
+    for (void *slab: _slabs) {
+        ::operator delete(slab, std::align_val_t(_alignment));
+    }
+}
+
+// # SlabPool class public interface
+// ######################################################################################################################
+
+void *SlabPool::allocate() {
+    if (_freeList == nullptr) {
+        _addSlab();
+    }
+
+    FreeBlock *block = _freeList;
+    _freeList = block->next;
+    _size++;
+    return block;
+}
+
+void SlabPool::deallocate(void *block) noexcept {
+    _freeList = ::new(block) FreeBlock{_freeList};
+    _size--;
+}
+
+// # SlabPool class private members
+// ######################################################################################################################
+
+size_t SlabPool::_getBlockSize(size_t blockSize, size_t alignment) {
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        throw std::runtime_error("SlabPool::SlabPool: ERROR - The alignment must be a power of two.");
+    }
+
+    // Every block must hold a free list link and keep the next block aligned
+    alignment = std::max(alignment, alignof(FreeBlock));
+    blockSize = std::max(blockSize, sizeof(FreeBlock));
+    return (blockSize + alignment - 1) & ~(alignment - 1);
+}
+
+void SlabPool::_addSlab() {
+    // The slot is added first, so that a failed push_back() can't leak the slab
+    _slabs.push_back(nullptr);
+    char *slab;
+    try {
+        slab = static_cast<char *>(::operator new(_blockSize * _blocksPerSlab, std::align_val_t(_alignment)));
+    } catch (...) {
+        _slabs.pop_back();
+        throw;
+    }
+    _slabs.back() = slab;
+
+    // In reverse, so that the blocks are handed out in the address order
+    for (size_t i = _blocksPerSlab; i > 0; i--) {
+        _freeList = ::new(slab + (i - 1) * _blockSize) FreeBlock{_freeList};
+    }
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+/**
+ * Allocator of fixed size blocks, used by Epoll for the per-descriptor records, so that connection churn doesn't reach the
+ * global allocator. Blocks are carved from slabs of blocksPerSlab blocks, a freed block goes to a free list and is reused by
+ * the next allocation. Slabs are released only by the destructor, the pool keeps the memory of its busiest moment.
+ * All blocks must be freed before the pool is destroyed. Not thread safe, Epoll uses its pools only from the loop thread.
+ */
+class SlabPool {
+public:
+    /**
+     * @param blockSize size of every block, at least the size of a pointer is used
+     * @param alignment alignment of every block, a power of two
+     * @param blocksPerSlab number of blocks allocated at once when the free list is empty
+     */
+    explicit SlabPool(size_t blockSize, size_t alignment = alignof(std::max_align_t), size_t blocksPerSlab = 64);
+
+    // Blocks point into the slabs, the pool can't be copied
+    SlabPool(const SlabPool &) = delete;
+
+    SlabPool &operator=(const SlabPool &) = delete;
+
+    ~SlabPool();
+
+    void *allocate();
+
+    void deallocate(void *block) noexcept;
+
+    /**
+     * Constructs an object in a new block, the block must fit the object
+     */
+    template<typename T, typename... Args>
+    T *create(Args &&... args) {
+        void *block = allocate();
+        try {
+            return ::new(block) T(std::forward<Args>(args)...);
+        } catch (...) {
+            deallocate(block);
+            throw;
+        }
+    }
+
+    template<typename T>
+    void destroy(T *object) noexcept {
+        object->~T();
+        deallocate(object);
+    }
+
+    size_t getBlockSize() const { return _blockSize; }
+
+    /**
+     * Number of blocks which are allocated and not freed yet
+     */
+    size_t size() const { return _size; }
+
+    /**
+     * Number of blocks in all slabs, used or free
+     */
+    size_t capacity() const { return _slabs.size() * _blocksPerSlab; }
+
+private:
+    struct FreeBlock {
+        FreeBlock *next;
+    };
+
+    const size_t _blockSize;
+    const size_t _alignment;
+    const size_t _blocksPerSlab;
+    std::vector<void *> _slabs{};
+    FreeBlock *_freeList = nullptr;
+    size_t _size = 0;
+
+    static size_t _getBlockSize(size_t blockSize, size_t alignment);
+
+    /**
+     * Allocates a new slab and puts all of its blocks to the free list
+     */
+    void _addSlab();
+};
+
+/**
+ * Deleter of std::unique_ptr for objects created by SlabPool::create(), see SlabPtr
+ */
+template<typename T>
+struct SlabDeleter {
+    SlabPool *pool = nullptr;
+
+    void operator()(T *object) const noexcept { pool->destroy(object); }
+};
+
+/**
+ * Owning pointer to an object in a SlabPool, the pool must outlive it. Like std::unique_ptr, T can be an incomplete type
+ * wherever the pointer isn't destroyed.
+ */
+template<typename T>
+using SlabPtr = std::unique_ptr<T, SlabDeleter<T>>;
+
+template<typename T, typename... Args>
+SlabPtr<T> makeSlabPtr(SlabPool &pool, Args &&... args) {
+    return SlabPtr<T>(pool.create<T>(std::forward<Args>(args)...), SlabDeleter<T>{&pool});
+}
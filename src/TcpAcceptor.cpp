@@ -0,0 +1,191 @@
+#include "TcpAcceptor.h"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <future>
+#include <netinet/in.h>
+#include <stdexcept>
+#include <unistd.h>
+#include <utility>
+
+TcpAcceptor::TcpAcceptor(EpollReactorPool &pool, std::string address, uint16_t port, AcceptHandler onAccept, int backlog)
+        : _pool(pool), _address(std::move(address)), _port(port), _onAccept(std::move(onAccept)), _backlog(backlog) {}
+
+TcpAcceptor::~TcpAcceptor() {
+    close();
+}
+
+// # TcpAcceptor class public interface
+// ######################################################################################################################
+
+void TcpAcceptor::open() {
+    if (isOpen()) {
+        throw std::runtime_error("TcpAcceptor::open: ERROR - The acceptor is already open.");
+    }
+
+    try {
+        for (size_t i = 0; i < _pool.size(); i++) {
+            auto listener = std::make_unique<Listener>(Listener{this, nullptr, _createListeningSocket()});
+            Listener *listenerPtr = listener.get();
+            _listeners.push_back(std::move(listener));
+
+            listenerPtr->spareFd = _openSpareFd();
+            if (listenerPtr->spareFd == -1) {
+                throw std::runtime_error("TcpAcceptor::open: ERROR - Failed to open the spare file descriptor.");
+            }
+
+            // All listeners must share the same port, port 0 is resolved by the first bind
+            if (_port == 0) {
+                struct sockaddr_in boundAddr{};
+                socklen_t boundAddrLen = sizeof(boundAddr);
+                getsockname(listenerPtr->fd, (struct sockaddr *) &boundAddr, &boundAddrLen);
+                _port = ntohs(boundAddr.sin_port);
+            }
+
+            _runOnReactor(i, [listenerPtr](Epoll &epoll) {
+                epoll.addDescriptor(listenerPtr->fd);
+                epoll.addEventHandler(listenerPtr->fd, EPOLLIN, _onListenerReady, listenerPtr);
+                listenerPtr->epoll = &epoll;
+            });
+        }
+    } catch (...) {
+        close();
+        throw;
+    }
+}
+
+void TcpAcceptor::close() {
+    for (size_t i = 0; i < _listeners.size(); i++) {
+        Listener *listenerPtr = _listeners[i].get();
+
+        if (listenerPtr->epoll != nullptr) {
+            _runOnReactor(i, [listenerPtr](Epoll &epoll) {
+                epoll.removeDescriptor(listenerPtr->fd);
+            });
+        }
+        ::close(listenerPtr->fd);
+        if (listenerPtr->spareFd != -1) {
+            ::close(listenerPtr->spareFd);
+        }
+    }
+    _listeners.clear();
+}
+
+// # TcpAcceptor class getters
+// ######################################################################################################################
+
+uint16_t TcpAcceptor::getPort() const {
+    return _port;
+}
+
+bool TcpAcceptor::isOpen() const {
+    return !_listeners.empty();
+}
+
+// # TcpAcceptor class private members
+// ######################################################################################################################
+
+int TcpAcceptor::_createListeningSocket() const {
+    struct sockaddr_in localAddr{};
+    localAddr.sin_family = AF_INET;
+    localAddr.sin_port = htons(_port);
+    if (inet_pton(AF_INET, _address.c_str(), &localAddr.sin_addr) != 1) {
+        throw std::runtime_error("TcpAcceptor::_createListeningSocket: ERROR - Invalid IPv4 address " + _address + ".");
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        throw std::runtime_error("TcpAcceptor::_createListeningSocket: ERROR - Failed to create a server socket (system resource error?)");
+    }
+
+    // Every reactor binds its own socket to the same address, the kernel balances new connections between them
+    int enable = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable)) != 0
+        || setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) != 0) {
+        ::close(fd);
+        throw std::runtime_error("TcpAcceptor::_createListeningSocket: ERROR - Failed to set SO_REUSEPORT on server socket.");
+    }
+
+    if (bind(fd, (struct sockaddr *) &localAddr, sizeof(struct sockaddr_in)) != 0) {
+        ::close(fd);
+        throw std::runtime_error("TcpAcceptor::_createListeningSocket: ERROR - Failed bind server socket. (Port: " + std::to_string(_port) + ")");
+    }
+
+    if (listen(fd, _backlog) != 0) {
+        ::close(fd);
+        throw std::runtime_error("TcpAcceptor::_createListeningSocket: ERROR - Failed listen on server socket. (FD" + std::to_string(fd) + ")");
+    }
+
+    return fd;
+}
+
+int TcpAcceptor::_openSpareFd() {
+    return ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+}
+
+bool TcpAcceptor::_shedConnection(Listener &listener) {
+    // The spare fd could be still missing after the last shedding, when another thread took the released fd number first
+    if (listener.spareFd == -1) {
+        listener.spareFd = _openSpareFd();
+        if (listener.spareFd == -1)
+            return false;
+    }
+
+    ::close(listener.spareFd);
+    const int clientFd = accept4(listener.fd, nullptr, nullptr, SOCK_CLOEXEC);
+    const int acceptError = errno;
+    if (clientFd != -1) {
+        ::close(clientFd);
+    }
+    listener.spareFd = _openSpareFd();
+
+    // Any other error (EAGAIN once the queue is empty) ends the draining
+    return clientFd != -1 || acceptError == ECONNABORTED;
+}
+
+void TcpAcceptor::_runOnReactor(size_t reactorIndex, std::function<void(Epoll &)> task) {
+    if (!_pool.isRunning()) {
+        task(_pool.getReactor(reactorIndex));
+        return;
+    }
+
+    auto done = std::make_shared<std::promise<void>>();
+    std::future<void> result = done->get_future();
+
+    _pool.post(reactorIndex, [&task, done](Epoll &epoll) {
+        try {
+            task(epoll);
+            done->set_value();
+        } catch (...) {
+            done->set_exception(std::current_exception());
+        }
+    });
+
+    result.get();
+}
+
+void TcpAcceptor::_onListenerReady(int listenerFd, void *context) {
+    auto *listener = static_cast<Listener *>(context);
+
+    // Drain the whole accept queue, in edge triggered mode there won't be another event for connections which are already waiting
+    for (;;) {
+        int clientFd = accept4(listenerFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+        if (clientFd == -1) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+
+            // Out of fds, the pending connections are closed instead of staying in the queue
+            if ((errno == EMFILE || errno == ENFILE) && _shedConnection(*listener))
+                continue;
+
+            // EAGAIN means the queue is empty, other errors (for example ENOBUFS) leave the connection waiting for the next event
+            return;
+        }
+
+        listener->epoll->addDescriptor(clientFd);
+        if (listener->acceptor->_onAccept) {
+            listener->acceptor->_onAccept(*listener->epoll, clientFd);
+        }
+    }
+}
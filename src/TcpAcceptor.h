@@ -0,0 +1,105 @@
+#pragma once
+
+#include "EpollReactorPool.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <sys/socket.h>
+#include <vector>
+
+/**
+ * Accepts TCP connections on every reactor of an EpollReactorPool.
+ * Each reactor gets its own SO_REUSEPORT listening socket, so the kernel spreads incoming connections across the reactor
+ * threads and no thread has to hand accepted connections over to another one. A ready listener is drained by accept4()
+ * until EAGAIN, the accepted non-blocking client fd is added straight into the Epoll of the reactor which accepted it.
+ * Every listener keeps a spare fd open. Once the process runs out of fds (EMFILE/ENFILE), the spare one is closed to accept
+ * and immediately close the pending connections, so they don't stay in the queue (busy looping in level triggered mode,
+ * stalling the listener in edge triggered mode) and their clients see the connection closed.
+ */
+class TcpAcceptor {
+public:
+    /**
+     * Called on the reactor thread after the client fd was added to that reactor's Epoll, add the event handlers here
+     */
+    using AcceptHandler = std::function<void(Epoll &, int)>;
+
+    static constexpr int DEFAULT_BACKLOG = SOMAXCONN;
+
+    /**
+     * @param pool reactors which will accept the connections, must outlive the acceptor
+     * @param address IPv4 address to listen on, for example "127.0.0.1" or "0.0.0.0"
+     * @param port port to listen on, use 0 to let the kernel choose one (see getPort())
+     * @param onAccept called for every accepted connection
+     * @param backlog length of the pending connections queue of each listening socket
+     */
+    TcpAcceptor(EpollReactorPool &pool, std::string address, uint16_t port, AcceptHandler onAccept, int backlog = DEFAULT_BACKLOG);
+
+    TcpAcceptor(const TcpAcceptor &) = delete;
+
+    TcpAcceptor &operator=(const TcpAcceptor &) = delete;
+
+    /**
+     * Creates, binds and registers one listening socket per reactor. If the pool is running, returns once all reactors listen.
+     * Must not be called from a reactor thread.
+     */
+    void open();
+
+    /**
+     * Unregisters and closes all listening sockets, already accepted connections are not affected.
+     * Must not be called from a reactor thread.
+     */
+    void close();
+
+    /**
+     * The port the listeners are bound to, useful if the acceptor was created with port 0
+     */
+    uint16_t getPort() const;
+
+    bool isOpen() const;
+
+    ~TcpAcceptor();
+
+private:
+    struct Listener {
+        TcpAcceptor *acceptor;
+        Epoll *epoll = nullptr;
+        int fd;
+        // Reserved for shedding connections while the process is out of fds, -1 if it couldn't be reopened
+        int spareFd = -1;
+    };
+
+    EpollReactorPool &_pool;
+    const std::string _address;
+    uint16_t _port;
+    const AcceptHandler _onAccept;
+    const int _backlog;
+    std::vector<std::unique_ptr<Listener>> _listeners{};
+
+    /**
+     * Creates a non-blocking SO_REUSEPORT socket listening on _address:_port
+     */
+    int _createListeningSocket() const;
+
+    /**
+     * Opens the fd which is reserved for _shedConnection()
+     * @return -1 if there is no fd left
+     */
+    static int _openSpareFd();
+
+    /**
+     * Accepts and closes one pending connection of a listener which hit EMFILE or ENFILE, using its spare fd
+     * @return false if the connection couldn't be accepted even with the spare fd released
+     */
+    static bool _shedConnection(Listener &listener);
+
+    /**
+     * Runs the task on the reactor thread and waits for it, or runs it right away if the pool isn't running
+     */
+    void _runOnReactor(size_t reactorIndex, std::function<void(Epoll &)> task);
+
+    /**
+     * EPOLLIN handler of a listening socket, context is the Listener
+     */
+    static void _onListenerReady(int listenerFd, void *context);
+};
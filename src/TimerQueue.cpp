@@ -0,0 +1,98 @@
+#include "TimerQueue.h"
+#include <algorithm>
+#include <utility>
+
+// # TimerQueue class public interface
+// ######################################################################################################################
+
+void TimerQueue::add(TimerId id, Clock::time_point deadline, Clock::duration interval, std::function<void()> callback) {
+    _timers[id] = Timer{interval, std::move(callback), deadline};
+    _heap.push_back(Entry{deadline, id});
+    std::push_heap(_heap.begin(), _heap.end());
+}
+
+bool TimerQueue::cancel(TimerId id) {
+    if (_timers.erase(id) == 0)
+        return false;
+
+    // Don't let the heap fill up with cancelled entries if nothing is left to run
+    if (_timers.empty()) {
+        _heap.clear();
+    }
+    return true;
+}
+
+void TimerQueue::runExpired(Clock::time_point now) {
+    for (;;) {
+        _dropStaleEntries();
+        if (_heap.empty() || _heap.front().deadline > now)
+            return;
+
+        const TimerId id = _heap.front().id;
+        _pop();
+
+        auto it = _timers.find(id);
+        if (it->second.interval == Clock::duration::zero()) {
+            std::function<void()> callback = std::move(it->second.callback);
+            _timers.erase(it);
+            callback();
+            continue;
+        }
+
+        // Schedule the next expiry before the call, a repeating timer which fell behind skips the missed periods
+        Timer &timer = it->second;
+        timer.deadline += timer.interval;
+        if (timer.deadline <= now) {
+            timer.deadline = now + timer.interval;
+        }
+        _heap.push_back(Entry{timer.deadline, id});
+        std::push_heap(_heap.begin(), _heap.end());
+
+        // The callback may cancel its own timer, which would destroy it in the middle of the call, so it's moved out meanwhile
+        std::function<void()> callback = std::move(timer.callback);
+        try {
+            callback();
+        } catch (...) {
+            _restoreCallback(id, std::move(callback));
+            throw;
+        }
+        _restoreCallback(id, std::move(callback));
+    }
+}
+
+TimerQueue::Clock::time_point TimerQueue::getNextDeadline() {
+    _dropStaleEntries();
+    return _heap.empty() ? Clock::time_point::max() : _heap.front().deadline;
+}
+
+size_t TimerQueue::size() const {
+    return _timers.size();
+}
+
+bool TimerQueue::empty() const {
+    return _timers.empty();
+}
+
+// # TimerQueue class private members
+// ######################################################################################################################
+
+void TimerQueue::_dropStaleEntries() {
+    while (!_heap.empty()) {
+        auto it = _timers.find(_heap.front().id);
+        if (it != _timers.end() && it->second.deadline == _heap.front().deadline)
+            return;
+        _pop();
+    }
+}
+
+void TimerQueue::_pop() {
+    std::pop_heap(_heap.begin(), _heap.end());
+    _heap.pop_back();
+}
+
+void TimerQueue::_restoreCallback(TimerId id, std::function<void()> callback) {
+    auto it = _timers.find(id);
+    if (it != _timers.end()) {
+        it->second.callback = std::move(callback);
+    }
+}
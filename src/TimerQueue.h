@@ -0,0 +1,78 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Timers of one Epoll instance ordered by their deadlines (binary min-heap).
+ * Cancelled timers are only dropped from the callback map, their heap entries are skipped once they reach the top.
+ * Not thread safe, Epoll uses it only from the loop thread.
+ */
+class TimerQueue {
+public:
+    using Clock = std::chrono::steady_clock;
+    using TimerId = uint64_t;
+
+    /**
+     * @param id unique id of the timer, chosen by the caller
+     * @param deadline when the callback will be called for the first time
+     * @param interval period of a repeating timer, zero for a one-shot timer
+     */
+    void add(TimerId id, Clock::time_point deadline, Clock::duration interval, std::function<void()> callback);
+
+    /**
+     * @return false if there is no such timer (it already expired or was cancelled)
+     */
+    bool cancel(TimerId id);
+
+    /**
+     * Calls the callbacks of all timers which expired by now, repeating timers are scheduled again.
+     * Callbacks can add and cancel timers, including their own.
+     */
+    void runExpired(Clock::time_point now);
+
+    /**
+     * Deadline of the earliest timer, Clock::time_point::max() if there are no timers
+     */
+    Clock::time_point getNextDeadline();
+
+    size_t size() const;
+
+    bool empty() const;
+
+private:
+    struct Entry {
+        Clock::time_point deadline;
+        TimerId id;
+
+        // std::push_heap() builds a max-heap, the earliest deadline must compare as the greatest
+        bool operator<(const Entry &other) const {
+            return deadline > other.deadline;
+        }
+    };
+
+    struct Timer {
+        Clock::duration interval;
+        std::function<void()> callback;
+        // Deadline of the heap entry which is currently valid for this timer
+        Clock::time_point deadline;
+    };
+
+    std::vector<Entry> _heap{};
+    std::unordered_map<TimerId, Timer> _timers{};
+
+    /**
+     * Pops heap entries of cancelled (or rescheduled) timers until a live one is on the top
+     */
+    void _dropStaleEntries();
+
+    void _pop();
+
+    /**
+     * Gives a repeating timer its callback back after the call, unless the timer was cancelled meanwhile
+     */
+    void _restoreCallback(TimerId id, std::function<void()> callback);
+};
@@ -0,0 +1,255 @@
+#include "TimingWheel.h"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+TimingWheel::TimingWheel(Clock::duration tick) : _tick(tick), _start(Clock::now()) {
+    if (tick <= Clock::duration::zero()) {
+        throw std::runtime_error("TimingWheel::TimingWheel: ERROR - The tick must be positive.");
+    }
+    _slotHeads.fill(NIL);
+}
+
+// # TimingWheel class public interface
+// ######################################################################################################################
+
+TimingWheel::TimeoutId TimingWheel::add(Clock::duration timeout, TimeoutHandler handler) {
+    const uint32_t index = _allocateNode();
+    Node &node = _nodes[index];
+    node.expiryTick = _getExpiryTick(timeout);
+    node.handler = std::move(handler);
+    _link(index);
+    _size++;
+
+    return (uint64_t(node.generation) << 32) | index;
+}
+
+bool TimingWheel::reset(TimeoutId id, Clock::duration timeout) {
+    Node *node = _findNode(id);
+    if (node == nullptr)
+        return false;
+
+    const uint32_t index = uint32_t(id);
+    _unlink(index);
+    node->expiryTick = _getExpiryTick(timeout);
+    _link(index);
+    return true;
+}
+
+bool TimingWheel::cancel(TimeoutId id) {
+    if (_findNode(id) == nullptr)
+        return false;
+
+    const uint32_t index = uint32_t(id);
+    _unlink(index);
+    _freeNode(index);
+    return true;
+}
+
+void TimingWheel::advance(Clock::time_point now) {
+    if (now < _start)
+        return;
+
+    const uint64_t targetTick = uint64_t((now - _start) / _tick);
+
+    // Jump straight over ticks in which nothing happens
+    for (;;) {
+        const uint64_t nextTick = _getNextEventTick();
+        if (nextTick > targetTick)
+            break;
+
+        _currentTick = nextTick;
+        try {
+            _processTick(nextTick);
+        } catch (...) {
+            // Timeouts which are left in the slot expire during the next advance(), cascading the same tick again is harmless
+            _currentTick = nextTick - 1;
+            throw;
+        }
+    }
+
+    _currentTick = std::max(_currentTick, targetTick);
+}
+
+TimingWheel::Clock::time_point TimingWheel::getNextDeadline() const {
+    const uint64_t nextTick = _getNextEventTick();
+    if (nextTick == UINT64_MAX)
+        return Clock::time_point::max();
+
+    return _start + _tick * nextTick;
+}
+
+size_t TimingWheel::size() const {
+    return _size;
+}
+
+bool TimingWheel::empty() const {
+    return _size == 0;
+}
+
+// # TimingWheel class private members
+// ######################################################################################################################
+
+TimingWheel::Node *TimingWheel::_findNode(TimeoutId id) {
+    const uint32_t index = uint32_t(id);
+    if (index >= _nodes.size())
+        return nullptr;
+
+    Node &node = _nodes[index];
+    if (node.generation != uint32_t(id >> 32) || node.slot == NIL)
+        return nullptr;
+
+    return &node;
+}
+
+uint32_t TimingWheel::_allocateNode() {
+    if (_freeNodes != NIL) {
+        const uint32_t index = _freeNodes;
+        _freeNodes = _nodes[index].next;
+        return index;
+    }
+
+    if (_nodes.size() >= NIL) {
+        throw std::runtime_error("TimingWheel::_allocateNode: ERROR - Too many timeouts.");
+    }
+    _nodes.emplace_back();
+    return uint32_t(_nodes.size() - 1);
+}
+
+void TimingWheel::_freeNode(uint32_t index) {
+    Node &node = _nodes[index];
+    node.handler = nullptr;
+    node.slot = NIL;
+    node.previous = NIL;
+    // Generation 0 would make the id 0 valid
+    if (++node.generation == 0) {
+        node.generation = 1;
+    }
+
+    node.next = _freeNodes;
+    _freeNodes = index;
+    _size--;
+}
+
+uint64_t TimingWheel::_getExpiryTick(Clock::duration timeout) const {
+    // Counted from the current time, the wheel itself can be far behind it if advance() wasn't called for a while
+    const Clock::duration elapsed = std::max(Clock::now() - _start, Clock::duration::zero());
+    const uint64_t nowTick = uint64_t(elapsed / _tick);
+    timeout = std::clamp(timeout, Clock::duration::zero(), _tick * Clock::rep(MAX_TIMEOUT_TICKS));
+
+    // Round up, a timeout never expires early. Even a zero timeout waits for the next tick.
+    const uint64_t expiryTick = uint64_t((elapsed + timeout + _tick - Clock::duration(1)) / _tick);
+    return std::min(std::max(expiryTick, std::max(nowTick, _currentTick) + 1), _currentTick + MAX_TIMEOUT_TICKS);
+}
+
+void TimingWheel::_link(uint32_t index) {
+    Node &node = _nodes[index];
+    const uint64_t delta = node.expiryTick - _currentTick;
+
+    // The lowest level whose revolution covers the delta
+    int level = 0;
+    while (level < LEVELS_NUM - 1 && delta >= (uint64_t(1) << (SLOT_BITS * (level + 1)))) {
+        level++;
+    }
+    const uint32_t slotIndex = uint32_t(node.expiryTick >> (SLOT_BITS * level)) & (SLOTS_NUM - 1);
+    const uint32_t slot = level * SLOTS_NUM + slotIndex;
+
+    node.slot = slot;
+    node.previous = NIL;
+    node.next = _slotHeads[slot];
+    if (node.next != NIL) {
+        _nodes[node.next].previous = index;
+    }
+    _slotHeads[slot] = index;
+    _occupiedSlots[level][slotIndex / 64] |= uint64_t(1) << (slotIndex % 64);
+}
+
+void TimingWheel::_unlink(uint32_t index) {
+    Node &node = _nodes[index];
+
+    if (node.previous != NIL) {
+        _nodes[node.previous].next = node.next;
+    } else {
+        _slotHeads[node.slot] = node.next;
+    }
+    if (node.next != NIL) {
+        _nodes[node.next].previous = node.previous;
+    }
+
+    if (_slotHeads[node.slot] == NIL) {
+        const uint32_t level = node.slot / SLOTS_NUM;
+        const uint32_t slotIndex = node.slot % SLOTS_NUM;
+        _occupiedSlots[level][slotIndex / 64] &= ~(uint64_t(1) << (slotIndex % 64));
+    }
+}
+
+void TimingWheel::_processTick(uint64_t tick) {
+    // A completed revolution of a level brings in the next slot of the level above
+    for (int level = 1; level < LEVELS_NUM; level++) {
+        if ((tick >> (SLOT_BITS * (level - 1))) & (SLOTS_NUM - 1))
+            break;
+        _cascade(level, uint32_t(tick >> (SLOT_BITS * level)) & (SLOTS_NUM - 1));
+    }
+
+    // Take the nodes one by one, handlers can unlink other nodes of this slot
+    const uint32_t slot = uint32_t(tick) & (SLOTS_NUM - 1);
+    while (_slotHeads[slot] != NIL) {
+        const uint32_t index = _slotHeads[slot];
+        _unlink(index);
+
+        TimeoutHandler handler = std::move(_nodes[index].handler);
+        _freeNode(index);
+        handler();
+    }
+}
+
+void TimingWheel::_cascade(int level, uint32_t slotIndex) {
+    const uint32_t slot = level * SLOTS_NUM + slotIndex;
+    while (_slotHeads[slot] != NIL) {
+        const uint32_t index = _slotHeads[slot];
+        _unlink(index);
+        _link(index);
+    }
+}
+
+uint64_t TimingWheel::_getNextEventTick() const {
+    if (_size == 0)
+        return UINT64_MAX;
+
+    // A lowest level slot is processed in its tick, a slot of a higher level once the levels below complete a revolution
+    // right before it. Every timeout is placed less than one revolution of its level ahead, so the nearest occupied slot
+    // of each level is exact and the wheel never has to be advanced just to find out there is nothing to do.
+    uint64_t nextTick = UINT64_MAX;
+    for (int level = 0; level < LEVELS_NUM; level++) {
+        const int shift = SLOT_BITS * level;
+        const uint64_t position = (_currentTick >> shift) + 1;
+
+        const int distance = _findOccupiedSlot(level, uint32_t(position) & (SLOTS_NUM - 1));
+        if (distance >= 0) {
+            nextTick = std::min(nextTick, (position + distance) << shift);
+        }
+    }
+    return nextTick;
+}
+
+int TimingWheel::_findOccupiedSlot(int level, uint32_t from) const {
+    const auto &occupied = _occupiedSlots[level];
+    const uint32_t wordsNum = occupied.size();
+
+    // The first word is visited twice: its slots from "from" on, and after wrapping around its slots before "from"
+    for (uint32_t i = 0; i <= wordsNum; i++) {
+        const uint32_t word = (from / 64 + i) % wordsNum;
+        uint64_t bits = occupied[word];
+        if (i == 0) {
+            bits &= ~uint64_t(0) << (from % 64);
+        } else if (i == wordsNum) {
+            bits &= ~(~uint64_t(0) << (from % 64));
+        }
+
+        if (bits != 0) {
+            const uint32_t slotIndex = word * 64 + __builtin_ctzll(bits);
+            return int((slotIndex - from) & (SLOTS_NUM - 1));
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "InplaceFunction.h"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Hierarchical timing wheel for large numbers of coarse timeouts (for example an idle timeout of every connection).
+ * Adding, resetting and cancelling a timeout is O(1): a timeout is a node of an intrusive doubly linked list of one wheel slot.
+ * Time is split into ticks, the lowest level has a slot per tick, every higher level has a slot per revolution of the level below.
+ * Whenever a lower level completes a revolution, the next slot of the level above is cascaded (its timeouts are spread into
+ * the levels below), so each timeout is moved at most LEVELS_NUM - 1 times during its life.
+ * Nodes are kept in a pool which reuses freed nodes, ids carry a generation so a stale id never touches a reused node.
+ * Not thread safe, Epoll uses it only from the loop thread.
+ */
+class TimingWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+    using TimeoutId = uint64_t;
+    using TimeoutHandler = InplaceFunction<void()>;
+
+    static constexpr int SLOT_BITS = 8;
+    static constexpr int SLOTS_NUM = 1 << SLOT_BITS;
+    static constexpr int LEVELS_NUM = 4;
+    // Longer timeouts are shortened to this number of ticks (about 49 days with 1 ms ticks)
+    static constexpr uint64_t MAX_TIMEOUT_TICKS = (uint64_t(1) << (SLOT_BITS * LEVELS_NUM)) - 1;
+
+    /**
+     * @param tick resolution of the wheel, timeouts are rounded up to whole ticks
+     */
+    explicit TimingWheel(Clock::duration tick = std::chrono::milliseconds(1));
+
+    /**
+     * Schedules a one-shot timeout
+     * @return id of the timeout, never 0
+     */
+    TimeoutId add(Clock::duration timeout, TimeoutHandler handler);
+
+    /**
+     * Moves the expiry of a pending timeout to now + timeout
+     * @return false if the timeout already expired or was cancelled
+     */
+    bool reset(TimeoutId id, Clock::duration timeout);
+
+    /**
+     * @return false if the timeout already expired or was cancelled
+     */
+    bool cancel(TimeoutId id);
+
+    /**
+     * Moves the wheel to now and calls the handlers of the expired timeouts.
+     * Handlers can add, reset and cancel timeouts, including their own id (which is already invalid at the time of the call).
+     */
+    void advance(Clock::time_point now);
+
+    /**
+     * Time when the wheel has to be advanced next (a timeout expires, or a slot with timeouts has to be cascaded).
+     * Clock::time_point::max() if there are no timeouts.
+     */
+    Clock::time_point getNextDeadline() const;
+
+    size_t size() const;
+
+    bool empty() const;
+
+private:
+    static constexpr uint32_t NIL = UINT32_MAX;
+
+    struct Node {
+        uint64_t expiryTick = 0;
+        uint32_t previous = NIL;
+        uint32_t next = NIL;
+        // Bumped every time the node is freed, the upper half of TimeoutId
+        uint32_t generation = 1;
+        // level * SLOTS_NUM + index of the slot the node is linked into, NIL while the node is free
+        uint32_t slot = NIL;
+        TimeoutHandler handler{};
+    };
+
+    const Clock::duration _tick;
+    const Clock::time_point _start;
+    // Number of the last processed tick, counted from _start
+    uint64_t _currentTick = 0;
+
+    std::vector<Node> _nodes{};
+    uint32_t _freeNodes = NIL;
+    size_t _size = 0;
+
+    std::array<uint32_t, LEVELS_NUM * SLOTS_NUM> _slotHeads{};
+    // Bit i is set if slot i of the level isn't empty, makes finding the next occupied slot a couple of ctz instructions
+    std::array<std::array<uint64_t, SLOTS_NUM / 64>, LEVELS_NUM> _occupiedSlots{};
+
+    /**
+     * Returns the node of a pending timeout, nullptr for a stale or unknown id
+     */
+    Node *_findNode(TimeoutId id);
+
+    uint32_t _allocateNode();
+
+    void _freeNode(uint32_t index);
+
+    /**
+     * Converts a timeout counted from now to the tick in which it expires, always later than _currentTick
+     */
+    uint64_t _getExpiryTick(Clock::duration timeout) const;
+
+    /**
+     * Links the node into the slot which matches its expiry tick
+     */
+    void _link(uint32_t index);
+
+    void _unlink(uint32_t index);
+
+    /**
+     * Processes the tick: cascades the higher levels if a revolution completed and expires the timeouts of the lowest level slot
+     */
+    void _processTick(uint64_t tick);
+
+    /**
+     * Moves all timeouts of the slot to the levels below
+     */
+    void _cascade(int level, uint32_t slotIndex);
+
+    /**
+     * The next tick after _currentTick which has to be processed, UINT64_MAX if the wheel is empty
+     */
+    uint64_t _getNextEventTick() const;
+
+    /**
+     * Distance from slot "from" to the nearest occupied slot of the level (wrapping around), -1 if the level is empty
+     */
+    int _findOccupiedSlot(int level, uint32_t from) const;
+};
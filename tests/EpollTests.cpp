@@ -0,0 +1,878 @@
+/**
+ * Regression tests of the Epoll library. Run "epoll_tests <name>" for a single test, or without arguments for all of them.
+ * A failed check throws, the test then exits with 1.
+ */
+#include "Connection.h"
+#include "Epoll.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <memory>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+#include <stdexcept>
+#include <string>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) \
+            throw std::runtime_error(std::string(__FILE__) + ":" + std::to_string(__LINE__) + ": CHECK(" #condition ") failed"); \
+    } while (false)
+
+namespace {
+
+// # cross_thread_registration
+// ######################################################################################################################
+
+constexpr int FOREIGN_THREADS_NUM = 4;
+constexpr int ITERATIONS_NUM = 500;
+
+struct CrossThreadState {
+    Epoll epoll{false};
+    std::atomic<int> readsNum{0};
+    std::atomic<int> postedTasksNum{0};
+};
+
+/**
+ * Foreign threads add descriptors and handlers, post tasks and remove descriptors while the loop thread dispatches.
+ * Every even iteration makes its socket readable, the handler on the loop thread removes and closes it. Every odd
+ * iteration removes its socket from the foreign thread right away and closes it by a posted task, which runs after the removal.
+ */
+void testCrossThreadRegistration() {
+    CrossThreadState state;
+    std::atomic<bool> isLoopRunning{false};
+    std::atomic<bool> isDone{false};
+
+    std::thread loopThread([&] {
+        // The first pass makes this the loop thread, calls from the other threads are deferred from then on
+        state.epoll.post([&] { isLoopRunning = true; });
+        while (!isDone.load()) {
+            state.epoll.waitForEvents(10);
+        }
+    });
+    while (!isLoopRunning.load()) {
+        std::this_thread::yield();
+    }
+
+    std::vector<std::thread> foreignThreads;
+    for (int t = 0; t < FOREIGN_THREADS_NUM; t++) {
+        foreignThreads.emplace_back([&state] {
+            for (int i = 0; i < ITERATIONS_NUM; i++) {
+                int pair[2];
+                if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, pair) == -1)
+                    throw std::runtime_error("socketpair failed");
+
+                const int peerFd = pair[0];
+                const int fd = pair[1];
+                state.epoll.addDescriptor(fd);
+                state.epoll.addEventHandler(fd, EPOLLIN, [&state, peerFd](int readyFd) {
+                    char byte;
+                    if (read(readyFd, &byte, 1) != 1)
+                        return;
+
+                    state.readsNum++;
+                    state.epoll.removeDescriptor(readyFd);
+                    close(readyFd);
+                    close(peerFd);
+                });
+
+                if (i % 2 == 0) {
+                    (void) !write(peerFd, "x", 1);
+                } else {
+                    state.epoll.removeDescriptor(fd);
+                    state.epoll.post([peerFd, fd] {
+                        close(peerFd);
+                        close(fd);
+                    });
+                }
+                state.epoll.post([&state] { state.postedTasksNum++; });
+            }
+        });
+    }
+    for (auto &thread: foreignThreads) {
+        thread.join();
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (state.readsNum.load() < FOREIGN_THREADS_NUM * ITERATIONS_NUM / 2
+           || state.postedTasksNum.load() < FOREIGN_THREADS_NUM * ITERATIONS_NUM) {
+        CHECK(std::chrono::steady_clock::now() < deadline);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    isDone = true;
+    state.epoll.post([] {});
+    loopThread.join();
+
+    CHECK(state.readsNum.load() == FOREIGN_THREADS_NUM * ITERATIONS_NUM / 2);
+    CHECK(state.postedTasksNum.load() == FOREIGN_THREADS_NUM * ITERATIONS_NUM);
+    CHECK(state.epoll.getMonitoredFds().empty());
+}
+
+// # fd_reuse_during_batch
+// ######################################################################################################################
+
+/**
+ * Makes a non-blocking socket pair, the second socket gets the number fd if it's not -1
+ */
+void makeSocketPair(int (&pair)[2], int fd = -1) {
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, pair) == 0);
+    if (fd == -1 || pair[1] == fd)
+        return;
+
+    if (pair[0] == fd) {
+        std::swap(pair[0], pair[1]);
+        return;
+    }
+    CHECK(dup2(pair[1], fd) == fd);
+    close(pair[1]);
+    pair[1] = fd;
+}
+
+struct FdReuseState {
+    Epoll *epoll = nullptr;
+    int fds[2]{};
+    int peerFds[2]{};
+    int oldHandlerCallsNum = 0;
+    int newHandlerCallsNum = 0;
+    int newPeerFd = -1;
+};
+
+/**
+ * Two sockets are readable in the same batch. The handler of the first one removes and closes the second one and registers
+ * a new socket under the same fd number, the pending event of the closed socket must not reach the new registration.
+ */
+void runFdReuseDuringBatch(EpollBackend backend) {
+    Epoll epoll{false, Epoll::DEFAULT_BATCH_SIZE, Epoll::DEFAULT_MAX_BATCH_SIZE, backend};
+    FdReuseState state;
+    state.epoll = &epoll;
+
+    for (int i = 0; i < 2; i++) {
+        int pair[2];
+        CHECK(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, pair) == 0);
+        state.peerFds[i] = pair[0];
+        state.fds[i] = pair[1];
+        CHECK(write(pair[0], "x", 1) == 1);
+    }
+
+    const auto onOldReadable = [&state](int fd) {
+        char byte;
+        CHECK(read(fd, &byte, 1) == 1);
+        state.oldHandlerCallsNum++;
+        const int otherFd = fd == state.fds[0] ? state.fds[1] : state.fds[0];
+
+        state.epoll->removeDescriptor(otherFd);
+        close(otherFd);
+
+        // The new socket gets the number of the closed one (usually the lowest free number already), it isn't readable yet
+        int pair[2];
+        CHECK(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, pair) == 0);
+        if (pair[1] == otherFd) {
+            state.newPeerFd = pair[0];
+        } else if (pair[0] == otherFd) {
+            state.newPeerFd = pair[1];
+        } else {
+            CHECK(dup2(pair[1], otherFd) == otherFd);
+            close(pair[1]);
+            state.newPeerFd = pair[0];
+        }
+
+        state.epoll->addDescriptor(otherFd);
+        state.epoll->addEventHandler(otherFd, EPOLLIN, [&state](int newFd) {
+            state.newHandlerCallsNum++;
+            char byte;
+            (void) !read(newFd, &byte, 1);
+        });
+    };
+
+    for (int fd: state.fds) {
+        epoll.addDescriptor(fd);
+        epoll.addEventHandler(fd, EPOLLIN, onOldReadable);
+    }
+
+    // Both events come in the first pass, the second pass must not see a stale event either
+    epoll.waitForEvents(100);
+    epoll.waitForEvents(50);
+    CHECK(state.oldHandlerCallsNum == 1);
+    CHECK(state.newHandlerCallsNum == 0);
+
+    // The new registration works
+    CHECK(write(state.newPeerFd, "y", 1) == 1);
+    epoll.waitForEvents(100);
+    CHECK(state.newHandlerCallsNum == 1);
+
+    for (int i = 0; i < 2; i++) {
+        epoll.removeDescriptor(state.fds[i]);
+        close(state.fds[i]);
+        close(state.peerFds[i]);
+    }
+    close(state.newPeerFd);
+}
+
+void testFdReuseDuringBatchEpoll() {
+    runFdReuseDuringBatch(EpollBackend::EPOLL);
+}
+
+void testFdReuseDuringBatchIoUring() {
+    runFdReuseDuringBatch(EpollBackend::IO_URING);
+}
+
+// # fd_churn
+// ######################################################################################################################
+
+constexpr int CHURN_CONNECTIONS_NUM = 64;
+constexpr int CHURN_ROUNDS_NUM = 200;
+
+struct ChurnState;
+
+struct ChurnConnection {
+    ChurnState *state = nullptr;
+    size_t index = 0;
+    int fd = -1;
+    int peerFd = -1;
+    // Changes with every new registration, the handler of a registration knows its own id
+    unsigned id = 0;
+    // A byte with the id was written to the peer and the handler hasn't read it yet
+    bool isPending = false;
+};
+
+struct ChurnState {
+    Epoll *epoll = nullptr;
+    std::vector<ChurnConnection> connections;
+    unsigned nextId = 1;
+    int round = 0;
+    long deliveredNum = 0;
+    long replacedNum = 0;
+};
+
+void registerChurnConnection(ChurnState &state, size_t index);
+
+/**
+ * Closes the connection at this index and opens a new one under the same fd number. Half of the new connections are
+ * readable right away, their event has to come in a later batch than the stale one of the closed socket.
+ */
+void replaceChurnConnection(ChurnState &state, size_t index) {
+    ChurnConnection &connection = state.connections[index];
+    const int fd = connection.fd;
+    state.epoll->removeDescriptor(fd);
+    close(fd);
+    close(connection.peerFd);
+
+    int pair[2];
+    makeSocketPair(pair, fd);
+    connection.peerFd = pair[0];
+    connection.id = state.nextId++;
+    connection.isPending = false;
+    registerChurnConnection(state, index);
+    state.replacedNum++;
+
+    if (connection.id % 2 == 0) {
+        const char byte = static_cast<char>(connection.id);
+        CHECK(write(connection.peerFd, &byte, 1) == 1);
+        connection.isPending = true;
+    }
+}
+
+void registerChurnConnection(ChurnState &state, size_t index) {
+    ChurnConnection &connection = state.connections[index];
+    const unsigned id = connection.id;
+    state.epoll->addDescriptor(connection.fd);
+    state.epoll->addEventHandler(connection.fd, EPOLLIN, [&connection, id](int fd) {
+        ChurnState &state = *connection.state;
+        const size_t index = connection.index;
+        // An event of a closed socket reaching the new registration of its fd finds no data and fails here
+        CHECK(connection.id == id);
+        CHECK(connection.fd == fd);
+        CHECK(connection.isPending);
+        char byte;
+        CHECK(read(fd, &byte, 1) == 1);
+        CHECK(byte == static_cast<char>(id));
+        connection.isPending = false;
+        state.deliveredNum++;
+
+        // Replaces a connection whose event may be still ahead in this batch, one already handled or this one itself
+        if ((index + state.round) % 4 == 0) {
+            replaceChurnConnection(state, (index * 7 + state.round) % state.connections.size());
+        }
+    });
+}
+
+/**
+ * Every round makes all connections readable, so their events come in the same batch. The handlers close and reopen
+ * many of the fds during the batch, every byte written to a live connection has to reach exactly its own handler.
+ */
+void runFdChurn(EpollBackend backend) {
+    Epoll epoll{false, Epoll::DEFAULT_BATCH_SIZE, Epoll::DEFAULT_MAX_BATCH_SIZE, backend};
+    ChurnState state;
+    state.epoll = &epoll;
+    state.connections.resize(CHURN_CONNECTIONS_NUM);
+
+    for (size_t i = 0; i < state.connections.size(); i++) {
+        int pair[2];
+        makeSocketPair(pair);
+        state.connections[i].state = &state;
+        state.connections[i].index = i;
+        state.connections[i].fd = pair[1];
+        state.connections[i].peerFd = pair[0];
+        state.connections[i].id = state.nextId++;
+        registerChurnConnection(state, i);
+    }
+
+    long writtenNum = 0;
+    for (state.round = 0; state.round < CHURN_ROUNDS_NUM; state.round++) {
+        for (ChurnConnection &connection: state.connections) {
+            if (connection.isPending)
+                continue;
+            const char byte = static_cast<char>(connection.id);
+            CHECK(write(connection.peerFd, &byte, 1) == 1);
+            connection.isPending = true;
+            writtenNum++;
+        }
+
+        // No event may be lost, every pending byte is read within a few passes
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+        const auto isAnyPending = [&state] {
+            for (const ChurnConnection &connection: state.connections) {
+                if (connection.isPending)
+                    return true;
+            }
+            return false;
+        };
+        while (isAnyPending()) {
+            CHECK(std::chrono::steady_clock::now() < deadline);
+            epoll.waitForEvents(100);
+        }
+    }
+
+    // The bytes written by replaceChurnConnection() count as well, the bytes of the closed sockets are dropped with them
+    CHECK(state.replacedNum > CHURN_ROUNDS_NUM);
+    CHECK(state.deliveredNum >= writtenNum - state.replacedNum);
+    CHECK(epoll.getMonitoredFds().size() == state.connections.size());
+
+    for (ChurnConnection &connection: state.connections) {
+        epoll.removeDescriptor(connection.fd);
+        close(connection.fd);
+        close(connection.peerFd);
+    }
+}
+
+void testFdChurnEpoll() {
+    runFdChurn(EpollBackend::EPOLL);
+}
+
+void testFdChurnIoUring() {
+    runFdChurn(EpollBackend::IO_URING);
+}
+
+// # io_uring backend
+// ######################################################################################################################
+
+/**
+ * A completion of a removed poll request which is already in the ring must not reach a new registration of the same fd number
+ */
+void testIoUringStaleCompletion() {
+    Epoll epoll{false, Epoll::DEFAULT_BATCH_SIZE, Epoll::DEFAULT_MAX_BATCH_SIZE, EpollBackend::IO_URING};
+    int oldPair[2];
+    makeSocketPair(oldPair);
+
+    epoll.addDescriptor(oldPair[1]);
+    epoll.addEventHandler(oldPair[1], EPOLLIN, [](int) {});
+    // Submits the poll request, then the readiness completes it without any wait
+    epoll.waitForEvents(0);
+    CHECK(write(oldPair[0], "x", 1) == 1);
+
+    const int fd = oldPair[1];
+    epoll.removeDescriptor(fd);
+    close(oldPair[0]);
+    close(fd);
+
+    int newPair[2];
+    makeSocketPair(newPair, fd);
+    int newHandlerCallsNum = 0;
+    epoll.addDescriptor(fd);
+    epoll.addEventHandler(fd, EPOLLIN, [&newHandlerCallsNum](int) { newHandlerCallsNum++; });
+
+    epoll.waitForEvents(50);
+    CHECK(newHandlerCallsNum == 0);
+
+    CHECK(write(newPair[0], "y", 1) == 1);
+    epoll.waitForEvents(100);
+    CHECK(newHandlerCallsNum > 0);
+
+    epoll.removeDescriptor(fd);
+    close(newPair[0]);
+    close(fd);
+}
+
+/**
+ * Waits up to a second until the peer of the socket pair reads the end of stream
+ */
+bool isPeerClosed(int fd) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (std::chrono::steady_clock::now() < deadline) {
+        char byte;
+        if (read(fd, &byte, 1) == 0)
+            return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+}
+
+/**
+ * A removed and closed socket is released by the kernel even if the loop doesn't wait again, both after a removal outside
+ * of a pass and after a removal by a handler. The multishot polls of the edge triggered mode stay armed until they are removed.
+ */
+void testIoUringRemovalSubmitted() {
+    Epoll epoll{true, Epoll::DEFAULT_BATCH_SIZE, Epoll::DEFAULT_MAX_BATCH_SIZE, EpollBackend::IO_URING};
+    int pairs[2][2];
+    for (auto &pair: pairs) {
+        makeSocketPair(pair);
+        epoll.addDescriptor(pair[1]);
+    }
+    epoll.addEventHandler(pairs[0][1], EPOLLIN, [](int) {});
+    epoll.addEventHandler(pairs[1][1], EPOLLIN, [&epoll](int fd) {
+        epoll.removeDescriptor(fd);
+        close(fd);
+    });
+    epoll.waitForEvents(0);
+
+    epoll.removeDescriptor(pairs[0][1]);
+    close(pairs[0][1]);
+    CHECK(isPeerClosed(pairs[0][0]));
+
+    CHECK(write(pairs[1][0], "x", 1) == 1);
+    epoll.waitForEvents(100);
+    CHECK(epoll.getMonitoredFds().empty());
+    CHECK(isPeerClosed(pairs[1][0]));
+
+    close(pairs[0][0]);
+    close(pairs[1][0]);
+}
+
+/**
+ * The completion queue of a small batch size is still big enough for the submission queue
+ */
+void testIoUringSmallBatch() {
+    Epoll epoll{false, 1, 8, EpollBackend::IO_URING};
+    int pair[2];
+    makeSocketPair(pair);
+
+    int handlerCallsNum = 0;
+    epoll.addDescriptor(pair[1]);
+    epoll.addEventHandler(pair[1], EPOLLIN, [&handlerCallsNum](int) { handlerCallsNum++; });
+    CHECK(write(pair[0], "x", 1) == 1);
+    epoll.waitForEvents(100);
+    CHECK(handlerCallsNum == 1);
+
+    epoll.removeDescriptor(pair[1]);
+    close(pair[0]);
+    close(pair[1]);
+}
+
+// # timeout_added_late
+// ######################################################################################################################
+
+/**
+ * A timeout added long after the wheel was last advanced must still be counted from the time of the call
+ */
+void testTimeoutAddedLate() {
+    TimingWheel wheel;
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    bool isExpired = false;
+    const TimingWheel::Clock::time_point addTime = TimingWheel::Clock::now();
+    wheel.add(std::chrono::milliseconds(200), [&isExpired] { isExpired = true; });
+
+    wheel.advance(TimingWheel::Clock::now());
+    CHECK(!isExpired);
+    wheel.advance(addTime + std::chrono::milliseconds(199));
+    CHECK(!isExpired);
+    wheel.advance(TimingWheel::Clock::now() + std::chrono::milliseconds(201));
+    CHECK(isExpired);
+
+    // The same through Epoll, whose wheel is advanced only by waitForEvents()
+    Epoll epoll{false};
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    isExpired = false;
+    const auto start = std::chrono::steady_clock::now();
+    epoll.addTimeout(std::chrono::milliseconds(100), [&isExpired] { isExpired = true; });
+    while (!isExpired) {
+        epoll.waitForEvents(1000);
+    }
+    CHECK(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(100));
+}
+
+// # pipe_async_io
+// ######################################################################################################################
+
+/**
+ * Runs the test in a child process which is killed by SIGALRM if it takes too long, a blocked loop fails instead of hanging
+ */
+void runWithDeadline(void (*test)()) {
+    const pid_t child = fork();
+    CHECK(child != -1);
+    if (child == 0) {
+        alarm(5);
+        try {
+            test();
+        } catch (const std::exception &e) {
+            std::printf("%s\n", e.what());
+            _exit(1);
+        }
+        _exit(0);
+    }
+
+    int status = 0;
+    CHECK(waitpid(child, &status, 0) == child);
+    CHECK(!WIFSIGNALED(status));
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+/**
+ * A write bigger than the pipe buffer waits for EPOLLOUT between its parts, no part may block the loop
+ */
+void runPipeAsyncWrite() {
+    Epoll epoll{false};
+    int pipeFds[2];
+    CHECK(pipe2(pipeFds, O_CLOEXEC) == 0);
+    epoll.addDescriptor(pipeFds[1]);
+
+    const std::vector<char> data(1024 * 1024, 'x');
+    ssize_t result = 0;
+    epoll.asyncWrite(pipeFds[1], data.data(), data.size(), [&result](int, ssize_t written) { result = written; });
+
+    std::vector<char> buffer(64 * 1024);
+    size_t totalRead = 0;
+    while (result == 0) {
+        epoll.waitForEvents(0);
+        const ssize_t status = read(pipeFds[0], buffer.data(), buffer.size());
+        CHECK(status > 0);
+        totalRead += status;
+    }
+    CHECK(result == ssize_t(data.size()));
+
+    ssize_t status;
+    while (totalRead < data.size() && (status = read(pipeFds[0], buffer.data(), buffer.size())) > 0) {
+        totalRead += status;
+    }
+    CHECK(totalRead == data.size());
+
+    epoll.removeDescriptor(pipeFds[1]);
+    close(pipeFds[0]);
+    close(pipeFds[1]);
+}
+
+/**
+ * The readiness of a pipe is used up by another handler of the same batch before its async read runs, the read must get
+ * EAGAIN and stay pending instead of blocking the loop
+ */
+void runPipeAsyncReadStaleReadiness() {
+    Epoll epoll{false};
+    int pipeFds[2];
+    CHECK(pipe2(pipeFds, O_CLOEXEC) == 0);
+    int pair[2];
+    makeSocketPair(pair);
+
+    // The socket becomes ready first, its handler is dispatched before the async read of the pipe
+    epoll.addDescriptor(pair[1]);
+    epoll.addEventHandler(pair[1], EPOLLIN, [&pipeFds](int fd) {
+        char byte;
+        CHECK(read(fd, &byte, 1) == 1);
+        CHECK(read(pipeFds[0], &byte, 1) == 1);
+    });
+
+    epoll.addDescriptor(pipeFds[0]);
+    char buffer[16];
+    bool isCalled = false;
+    epoll.asyncRead(pipeFds[0], buffer, sizeof(buffer), [&isCalled](int, ssize_t) { isCalled = true; });
+
+    CHECK(write(pair[0], "x", 1) == 1);
+    CHECK(write(pipeFds[1], "x", 1) == 1);
+    epoll.waitForEvents(1000);
+    CHECK(!isCalled);
+
+    CHECK(write(pipeFds[1], "y", 1) == 1);
+    epoll.waitForEvents(1000);
+    CHECK(isCalled);
+
+    epoll.removeDescriptor(pair[1]);
+    epoll.removeDescriptor(pipeFds[0]);
+    close(pair[0]);
+    close(pair[1]);
+    close(pipeFds[0]);
+    close(pipeFds[1]);
+}
+
+void testPipeAsyncWrite() {
+    runWithDeadline(&runPipeAsyncWrite);
+}
+
+void testPipeAsyncReadStaleReadiness() {
+    runWithDeadline(&runPipeAsyncReadStaleReadiness);
+}
+
+// # fixed_trigger_mode
+// ######################################################################################################################
+
+/**
+ * An Epoll whose traits fix the trigger mode works like Epoll constructed with that mode: an edge triggered one makes the added
+ * descriptors non-blocking, and a Connection (which reads in a loop only in edge triggered mode) echoes the data in both modes
+ */
+template<typename EpollType>
+void runFixedTriggerMode(bool isEdgeTriggered) {
+    EpollType epoll{};
+    CHECK(bool(epoll.isEdgeTriggered()) == isEdgeTriggered);
+
+    int pair[2];
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) == 0);
+    epoll.addConnection(pair[1], [](typename EpollType::Connection &connection) {
+        char buffer[64];
+        size_t size;
+        while ((size = connection.getInput().read(buffer, sizeof(buffer))) > 0) {
+            connection.write(buffer, size);
+        }
+    });
+    CHECK(((fcntl(pair[1], F_GETFL) & O_NONBLOCK) != 0) == isEdgeTriggered);
+
+    CHECK(write(pair[0], "ping", 4) == 4);
+    char reply[4];
+    size_t received = 0;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (received < sizeof(reply)) {
+        CHECK(std::chrono::steady_clock::now() < deadline);
+        epoll.waitForEvents(100);
+        const ssize_t status = recv(pair[0], reply + received, sizeof(reply) - received, MSG_DONTWAIT);
+        if (status > 0) {
+            received += status;
+        }
+    }
+    CHECK(std::memcmp(reply, "ping", 4) == 0);
+
+    // The connection closes its fd and removes itself once the peer closed
+    close(pair[0]);
+    while (!epoll.getMonitoredFds().empty()) {
+        CHECK(std::chrono::steady_clock::now() < deadline);
+        epoll.waitForEvents(100);
+    }
+}
+
+void testFixedTriggerMode() {
+    runFixedTriggerMode<LevelTriggeredEpoll>(false);
+    runFixedTriggerMode<EdgeTriggeredEpoll>(true);
+}
+
+// # inplace_function_allocate
+// ######################################################################################################################
+
+/**
+ * A callable too big for the inline storage is accepted only through allocate(), it then survives moves and is freed once
+ */
+void testInplaceFunctionAllocate() {
+    int first = 0;
+    int second = 0;
+    int third = 0;
+    auto counter = std::make_shared<int>(0);
+
+    EventHandler handler = EventHandler::allocate([&first, &second, &third, counter](int fd) {
+        first = second = third = fd;
+        (*counter)++;
+    });
+    CHECK(counter.use_count() == 2);
+
+    EventHandler moved = std::move(handler);
+    CHECK(handler == nullptr);
+    moved(7);
+    CHECK(first == 7 && second == 7 && third == 7 && *counter == 1);
+
+    moved = nullptr;
+    CHECK(counter.use_count() == 1);
+
+    CHECK(EventHandler::allocate(std::function<void(int)>()) == nullptr);
+}
+
+// # pwait2_blocked_by_seccomp
+// ######################################################################################################################
+
+/**
+ * A seccomp profile which doesn't know epoll_pwait2() makes it fail with EPERM, the loop must fall back to epoll_wait()
+ * instead of returning without events forever. The filter is installed in a child process, it can't be removed again.
+ */
+void testPwait2BlockedBySeccomp() {
+#ifdef SYS_epoll_pwait2
+    const pid_t child = fork();
+    CHECK(child != -1);
+    if (child == 0) {
+        sock_filter filter[] = {
+                BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(seccomp_data, nr)),
+                BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, SYS_epoll_pwait2, 0, 1),
+                BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ERRNO | (EPERM & SECCOMP_RET_DATA)),
+                BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW),
+        };
+        sock_fprog program{static_cast<unsigned short>(sizeof(filter) / sizeof(filter[0])), filter};
+        if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) == -1 || prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &program) == -1)
+            _exit(2);
+
+        Epoll epoll{false};
+        int pair[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, pair) == -1 || write(pair[0], "x", 1) != 1)
+            _exit(2);
+
+        bool isCalled = false;
+        epoll.addDescriptor(pair[1]);
+        epoll.addEventHandler(pair[1], EPOLLIN, [&isCalled](int) { isCalled = true; });
+        for (int i = 0; i < 100 && !isCalled; i++) {
+            epoll.waitForEvents(std::chrono::milliseconds(100));
+        }
+        _exit(isCalled ? 0 : 1);
+    }
+
+    int status = 0;
+    CHECK(waitpid(child, &status, 0) == child);
+    CHECK(WIFEXITED(status));
+    if (WEXITSTATUS(status) == 2) {
+        std::printf("Seccomp filters aren't available, skipped\n");
+        return;
+    }
+    CHECK(WEXITSTATUS(status) == 0);
+#endif
+}
+
+#ifdef EPOLL_CPP_COROUTINES
+// # coroutine_exception
+// ######################################################################################################################
+
+/**
+ * Stores the frame address of the awaiting coroutine, without suspending it
+ */
+struct FrameAddressAwaiter {
+    void *&frameAddress;
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> handle) const noexcept {
+        frameAddress = handle.address();
+        return false;
+    }
+
+    void await_resume() const noexcept {}
+};
+
+enum class CoroutineEnd {
+    RETURN,
+    THROW_AT_START,
+    THROW_AFTER_RESUME
+};
+
+EpollTask runCoroutine(Epoll &epoll, int fd, void *&frameAddress, CoroutineEnd end) {
+    co_await FrameAddressAwaiter{frameAddress};
+    if (end == CoroutineEnd::THROW_AT_START)
+        throw std::logic_error("Thrown at the start");
+
+    if (end == CoroutineEnd::THROW_AFTER_RESUME) {
+        co_await epoll.readable(fd);
+        throw std::logic_error("Thrown after a resumption");
+    }
+}
+
+/**
+ * An exception of a coroutine reaches the caller of the coroutine or waitForEvents() which resumed it, and the frame is freed.
+ * The frame pool returns the most recently freed frame first, so the next coroutine of the same size reuses a freed frame.
+ */
+void testCoroutineException() {
+    Epoll epoll{false};
+    int pair[2];
+    makeSocketPair(pair);
+    epoll.addDescriptor(pair[1]);
+    void *failedFrame = nullptr;
+    void *nextFrame = nullptr;
+
+    bool isThrown = false;
+    try {
+        runCoroutine(epoll, pair[1], failedFrame, CoroutineEnd::THROW_AT_START);
+    } catch (const std::logic_error &) {
+        isThrown = true;
+    }
+    CHECK(isThrown);
+    runCoroutine(epoll, pair[1], nextFrame, CoroutineEnd::RETURN);
+    CHECK(nextFrame == failedFrame);
+
+    runCoroutine(epoll, pair[1], failedFrame, CoroutineEnd::THROW_AFTER_RESUME);
+    CHECK(write(pair[0], "x", 1) == 1);
+    isThrown = false;
+    try {
+        epoll.waitForEvents(1000);
+    } catch (const std::logic_error &) {
+        isThrown = true;
+    }
+    CHECK(isThrown);
+    runCoroutine(epoll, pair[1], nextFrame, CoroutineEnd::RETURN);
+    CHECK(nextFrame == failedFrame);
+
+    epoll.removeDescriptor(pair[1]);
+    close(pair[0]);
+    close(pair[1]);
+}
+#endif
+
+struct Test {
+    const char *name;
+    void (*run)();
+};
+
+const Test tests[] = {
+        {"cross_thread_registration", &testCrossThreadRegistration},
+        {"fd_reuse_during_batch_epoll", &testFdReuseDuringBatchEpoll},
+        {"fd_reuse_during_batch_io_uring", &testFdReuseDuringBatchIoUring},
+        {"fd_churn_epoll", &testFdChurnEpoll},
+        {"fd_churn_io_uring", &testFdChurnIoUring},
+        {"timeout_added_late", &testTimeoutAddedLate},
+        {"io_uring_stale_completion", &testIoUringStaleCompletion},
+        {"io_uring_removal_submitted", &testIoUringRemovalSubmitted},
+        {"io_uring_small_batch", &testIoUringSmallBatch},
+        {"inplace_function_allocate", &testInplaceFunctionAllocate},
+        {"pwait2_blocked_by_seccomp", &testPwait2BlockedBySeccomp},
+        {"pipe_async_write", &testPipeAsyncWrite},
+        {"pipe_async_read_stale_readiness", &testPipeAsyncReadStaleReadiness},
+        {"fixed_trigger_mode", &testFixedTriggerMode},
+#ifdef EPOLL_CPP_COROUTINES
+        {"coroutine_exception", &testCoroutineException},
+#endif
+};
+
+}
+
+int main(int argc, char **argv) {
+    int failedNum = 0;
+    bool isFound = false;
+
+    for (const Test &test: tests) {
+        if (argc > 1 && std::strcmp(argv[1], test.name) != 0)
+            continue;
+
+        isFound = true;
+        try {
+            test.run();
+            std::printf("PASSED %s\n", test.name);
+        } catch (const std::exception &e) {
+            std::printf("FAILED %s: %s\n", test.name, e.what());
+            failedNum++;
+        }
+    }
+
+    if (!isFound) {
+        std::printf("Unknown test %s\n", argv[1]);
+        return 1;
+    }
+    return failedNum == 0 ? 0 : 1;
+}
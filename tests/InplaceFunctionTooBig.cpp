@@ -0,0 +1,14 @@
+/**
+ * Must not compile: the lambda captures three pointers, EventHandler stores at most two without allocating.
+ * Built by the inplace_function_too_big test, which expects the static_assert message of InplaceFunction.
+ */
+#include "Epoll.h"
+
+int main() {
+    int first = 0;
+    int second = 0;
+    int third = 0;
+    EventHandler handler = [&first, &second, &third](int fd) { first = second = third = fd; };
+    handler(0);
+    return first;
+}